@@ -0,0 +1,257 @@
+/*
+ * File: Curve.cxx
+ * Description: Point generation for spirograph style curves.
+ */
+
+#include "Curve.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <vector>
+using namespace std;
+
+Chain classicChain(double r, double R, double p) {
+    Chain c;
+    c.push_back(Term(R+r, 1));
+    c.push_back(Term(p, (R+r)/r));
+    return c;
+}
+
+Chain hypotrochoid(double r, double R, double p) {
+    Chain c;
+    c.push_back(Term(R-r, 1));
+    c.push_back(Term(p, -(R-r)/r));
+    return c;
+}
+
+Chain epitrochoid(double r, double R, double p) {
+    Chain c;
+    c.push_back(Term(R+r, 1));
+    c.push_back(Term(-p, (R+r)/r));
+    return c;
+}
+
+Chain nestedWheels(int wheels, int symmetry) {
+    //every speed is 1 mod symmetry, which gives the curve that many fold
+    //rotational symmetry. Each wheel is smaller than the one it rides on.
+    Chain c;
+    for (int k = 0; k < wheels; k++) {
+        int freq = 1 + symmetry * k * (k % 2 ? -1 : 1);
+        c.push_back(Term(polar(1.0 / (k+1), k * M_PI / 2), freq));
+    }
+    return c;
+}
+
+//adds a damped pendulum a cos(wt + phase) e^(-dt) swinging along dir
+static void addPendulum(Chain &c, Complex dir, double a, double w,
+        double phase, double d) {
+    c.push_back(Term(dir * polar(a/2, phase), w, d));
+    c.push_back(Term(dir * polar(a/2, -phase), -w, d));
+}
+
+Chain harmonograph() {
+    //two pendulums on each axis
+    Chain c;
+    addPendulum(c, 1, 1.0, 2.0, 0, 0.002);
+    addPendulum(c, 1, 1.0, 3.01, M_PI/2, 0.0015);
+    addPendulum(c, Complex(0,1), 1.0, 3.0, M_PI/4, 0.002);
+    addPendulum(c, Complex(0,1), 1.0, 2.0, 0, 0.0025);
+    return c;
+}
+
+double chainExtent(const Chain &chain) {
+    double e = 0;
+    for (size_t k = 0; k < chain.size(); k++) {
+        e += abs(chain[k].amp);
+    }
+    return e;
+}
+
+Chain shiftChain(const Chain &chain, double t0) {
+    Chain c(chain);
+    for (size_t k = 0; k < c.size(); k++) {
+        c[k].amp *= exp(-c[k].damp * t0) * polar(1.0, c[k].freq * t0);
+    }
+    return c;
+}
+
+double chainPeriod(const Chain &chain, double limit, double tol) {
+    //the curve can only repeat after whole turns of the slowest term
+    double slowest = 0;
+    for (size_t k = 0; k < chain.size(); k++) {
+        double w = fabs(chain[k].freq);
+        if (w > 0 && (0 == slowest || w < slowest)) slowest = w;
+    }
+    if (0 == slowest) return min(limit, 2 * M_PI); //the curve is a point
+
+    for (double t = 2 * M_PI / slowest; t < limit; t += 2 * M_PI / slowest) {
+        bool closed = true;
+        for (size_t k = 0; closed && k < chain.size(); k++) {
+            //how far the term is from where it started
+            double off = remainder(chain[k].freq * t, 2 * M_PI);
+            closed = abs(chain[k].amp) * fabs(off) <= tol;
+        }
+        if (closed) return t;
+    }
+    return limit;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//class CurveGenerator
+
+CurveGenerator::CurveGenerator(const Chain &chain, double h)
+    : terms(chain), h(h) {
+    mode = PHASOR;
+    reset();
+}
+
+void CurveGenerator::seek(uint64_t step) {
+    n = step;
+    blockValid = false;
+}
+
+Complex CurveGenerator::next() {
+    Complex z;
+    generate(1, NULL, &z);
+    return z;
+}
+
+void CurveGenerator::generate(size_t count, float *xyz) {
+    generate(count, xyz, NULL);
+}
+
+void CurveGenerator::generate(size_t count, float *xyz, Complex *z) {
+    size_t i = 0;
+    while (i < count) {
+        const double *x, *y;
+        size_t m;
+        double px, py;
+
+        if (DIRECT == mode) {
+            Complex d = eval(time());
+            px = d.real();
+            py = d.imag();
+            x = &px;
+            y = &py;
+            m = 1;
+        } else {
+            uint64_t first = n - n % BLOCK;
+            if (!blockValid || first != blockStart) {
+                fillBlock(first, bx, by);
+                blockStart = first;
+                blockValid = true;
+            }
+            size_t j = n - first;
+            x = bx + j;
+            y = by + j;
+            m = BLOCK - j < count - i ? BLOCK - j : count - i;
+        }
+
+        for (size_t q = 0; q < m; q++, i++) {
+            if (xyz) {
+                xyz[3*i+0] = x[q];
+                xyz[3*i+1] = y[q];
+                xyz[3*i+2] = 0;
+            }
+            if (z) {
+                z[i] = Complex(x[q], y[q]);
+            }
+        }
+        n += m;
+    }
+}
+
+Complex CurveGenerator::eval(double t) const {
+    Complex z;
+    for (size_t k = 0; k < terms.size(); k++) {
+        z += terms[k].amp * exp(-terms[k].damp * t) * polar(1.0, terms[k].freq * t);
+    }
+    return z;
+}
+
+void CurveGenerator::derivatives(double t, Complex &d1, Complex &d2) const {
+    d1 = d2 = 0;
+    for (size_t k = 0; k < terms.size(); k++) {
+        Complex s(-terms[k].damp, terms[k].freq);
+        Complex z = terms[k].amp * exp(-terms[k].damp * t) * polar(1.0, terms[k].freq * t);
+        d1 += s * z;
+        d2 += s * s * z;
+    }
+}
+
+//
+////////////////////////////////////////////////////////////////////////////////
+
+CurveGenerator *makeGenerator(const Chain &chain, double h) {
+    switch (chain.size()) {
+    case 1: return new ChainGenerator<1>(chain, h);
+    case 2: return new ChainGenerator<2>(chain, h);
+    case 3: return new ChainGenerator<3>(chain, h);
+    case 4: return new ChainGenerator<4>(chain, h);
+    case 5: return new ChainGenerator<5>(chain, h);
+    case 6: return new ChainGenerator<6>(chain, h);
+    default: return new ChainGenerator<0>(chain, h);
+    }
+}
+
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+//time to generate steps points in batches, in nanoseconds per point
+static double timeGenerate(CurveGenerator &g, uint64_t steps) {
+    const size_t batch = 4096;
+    vector<float> buf(3*batch);
+    volatile float sink = 0;
+
+    g.reset();
+    double start = seconds();
+    for (uint64_t i = 0; i < steps; i += batch) {
+        g.generate(batch, buf.data());
+        sink += buf[3*batch-3];
+    }
+    return 1e9 * (seconds() - start) / steps;
+}
+
+void benchmarkCurve(const Chain &chain, double h, uint64_t steps, ostream &out) {
+    CurveGenerator *g = makeGenerator(chain, h);
+    ChainGenerator<0> runtime(chain, h);
+
+    g->mode = CurveGenerator::PHASOR;
+    double phasorNs = timeGenerate(*g, steps);
+    double runtimeNs = timeGenerate(runtime, steps);
+    g->mode = CurveGenerator::DIRECT;
+    double directNs = timeGenerate(*g, steps);
+
+    //compare every phasor point against a direct evaluation of the same step
+    g->mode = CurveGenerator::PHASOR;
+    g->reset();
+    double maxErr = 0;
+    for (uint64_t i = 0; i < steps; i++) {
+        double t = g->time();
+        double err = abs(g->next() - g->eval(t));
+        if (err > maxErr) maxErr = err;
+    }
+
+    out << chain.size() << " term curve over " << steps << " steps" << endl
+        << "  direct:          " << directNs << " ns/point" << endl
+        << "  phasor:          " << phasorNs << " ns/point ("
+        << directNs / phasorNs << "x faster)" << endl
+        << "  phasor, runtime: " << runtimeNs << " ns/point" << endl
+        << "  max |phasor - direct|: " << maxErr << endl;
+
+    delete g;
+}
+
+void benchmarkTimeDrift(double dt, uint64_t steps, ostream &out) {
+    //how far the old float time accumulator drifts from step*dt
+    float animTime = 0.0f;
+    for (uint64_t i = 0; i < steps; i++) {
+        animTime += float(dt);
+    }
+    out << "float time accumulator after " << steps << " steps: t = "
+        << animTime << " (exact " << double(steps) * dt << ")" << endl;
+}
@@ -0,0 +1,252 @@
+/*
+ * File: Curve.hpp
+ * Description: Point generation for spirograph style curves.
+ *
+ * A curve is a chain of rotating terms
+ *
+ *   z(t) = sum_k a_k e^((i w_k - d_k) t)
+ *
+ * which covers hypotrochoids/epitrochoids (two terms), nested wheels (one
+ * term per wheel) and harmonographs (each damped pendulum is a pair of
+ * counter-rotating terms).
+ *
+ * The curve is sampled at t = n*h for n = 0,1,2,... where n is kept as an
+ * integer step count. Time is therefore always computed as a single double
+ * precision product and does not drift or lose resolution however long the
+ * animation has been running.
+ */
+
+#ifndef CURVE_HPP_
+#define CURVE_HPP_
+
+#include <complex>
+#include <ostream>
+#include <stdint.h>
+#include <vector>
+
+typedef std::complex<double> Complex;
+
+/**
+ * One rotating term a e^((iw - d)t) of a curve.
+ */
+struct Term {
+    Term(Complex amp = 0, double freq = 0, double damp = 0)
+        : amp(amp), freq(freq), damp(damp) {}
+
+    Complex amp; //radius and starting angle
+    double freq; //angular speed, negative turns clockwise
+    double damp; //exponential decay rate of the radius
+};
+
+typedef std::vector<Term> Chain;
+
+///
+///Chains for the curve types offered in the GUI.
+///
+Chain classicChain(double r, double R, double p); //the original main.cxx curve
+Chain hypotrochoid(double r, double R, double p);
+Chain epitrochoid(double r, double R, double p);
+Chain nestedWheels(int wheels, int symmetry);
+Chain harmonograph();
+
+///
+///Upper bound on |z(t)| for t >= 0 (assumes no term grows).
+///
+double chainExtent(const Chain &chain);
+
+///
+///The same curve started from t0, so its point at t is the chain's at t0 + t.
+///
+Chain shiftChain(const Chain &chain, double t0);
+
+/**
+ * Smallest t > 0 at which every term is back within tol of where it started
+ * (ignoring damping), so the curve repeats, or limit if there is none up to
+ * limit.
+ */
+double chainPeriod(const Chain &chain, double limit, double tol);
+
+/**
+ * Generates consecutive points of a chain.
+ *
+ * In PHASOR mode points are produced a block at a time. Each block starts
+ * from an exact evaluation of every term and fills in the rest by
+ * multiplying with a table of per step rotations, so no cos/sin calls are
+ * needed per point and rounding error never builds up past one block.
+ * The per point loop is independent across points so it vectorises.
+ *
+ * In DIRECT mode every point is evaluated with cos/sin.
+ *
+ * Use makeGenerator() to get a generator specialised for the chain length.
+ */
+class CurveGenerator {
+public:
+    enum Mode { DIRECT, PHASOR };
+
+    static const size_t BLOCK = 256; //points per exact restart
+
+    CurveGenerator(const Chain &chain, double h);
+    virtual ~CurveGenerator() {}
+
+    /**
+     * Restarts the curve at t = 0.
+     */
+    void reset() { seek(0); }
+
+    /**
+     * Moves to the given step so that the next point is at t = step*h.
+     */
+    void seek(uint64_t step);
+
+    /**
+     * Returns the point at the current step and advances to the next one.
+     */
+    Complex next();
+
+    /**
+     * Writes the next count points to xyz as (x, y, 0) triples.
+     */
+    void generate(size_t count, float *xyz);
+
+    /**
+     * Evaluates the curve directly at parameter t.
+     */
+    Complex eval(double t) const;
+
+    /**
+     * Evaluates the first and second derivative of the curve at t.
+     */
+    void derivatives(double t, Complex &d1, Complex &d2) const;
+
+    uint64_t step() const { return n; }
+    double stepSize() const { return h; }
+    double time() const { return double(n) * h; } //parameter of the next point
+    const Chain &chain() const { return terms; }
+
+    Mode mode;
+
+protected:
+    /**
+     * Writes points first .. first+BLOCK-1 to x and y.
+     */
+    virtual void fillBlock(uint64_t first, double *x, double *y) = 0;
+
+    Chain terms;
+    double h;
+
+private:
+    void generate(size_t count, float *xyz, Complex *z);
+
+    uint64_t n; //index of the next point
+    uint64_t blockStart; //index of the first point in bx/by
+    bool blockValid;
+    double bx[BLOCK], by[BLOCK];
+};
+
+/**
+ * Per term tables for ChainGenerator. N > 0 gives fixed size arrays so loops
+ * over the terms have a compile time trip count and get unrolled; N == 0 is
+ * the runtime sized fallback.
+ */
+template <int N>
+struct TermTables {
+    void resize(size_t) {}
+    size_t size() const { return N; }
+
+    double ampRe[N], ampIm[N];
+    double freq[N], damp[N];
+    double powRe[N*CurveGenerator::BLOCK]; //e^((iw - d)jh) for j < BLOCK
+    double powIm[N*CurveGenerator::BLOCK];
+};
+
+template <>
+struct TermTables<0> {
+    void resize(size_t n) {
+        count = n;
+        ampRe.resize(n); ampIm.resize(n);
+        freq.resize(n); damp.resize(n);
+        powRe.resize(n*CurveGenerator::BLOCK);
+        powIm.resize(n*CurveGenerator::BLOCK);
+    }
+    size_t size() const { return count; }
+
+    size_t count;
+    std::vector<double> ampRe, ampIm;
+    std::vector<double> freq, damp;
+    std::vector<double> powRe, powIm;
+};
+
+/**
+ * CurveGenerator for a chain of N terms (or any number of terms if N == 0).
+ */
+template <int N>
+class ChainGenerator : public CurveGenerator {
+public:
+    ChainGenerator(const Chain &chain, double h) : CurveGenerator(chain, h) {
+        tables.resize(chain.size());
+        for (size_t k = 0; k < tables.size(); k++) {
+            tables.ampRe[k] = chain[k].amp.real();
+            tables.ampIm[k] = chain[k].amp.imag();
+            tables.freq[k] = chain[k].freq;
+            tables.damp[k] = chain[k].damp;
+
+            //every entry is evaluated exactly rather than by repeated
+            //multiplication
+            for (size_t j = 0; j < BLOCK; j++) {
+                double s = double(j) * h;
+                Complex w = exp(-chain[k].damp * s) * std::polar(1.0, chain[k].freq * s);
+                tables.powRe[k*BLOCK + j] = w.real();
+                tables.powIm[k*BLOCK + j] = w.imag();
+            }
+        }
+    }
+
+protected:
+    virtual void fillBlock(uint64_t first, double *x, double *y) {
+        double t = double(first) * h;
+
+        for (size_t j = 0; j < BLOCK; j++) {
+            x[j] = 0;
+            y[j] = 0;
+        }
+
+        for (size_t k = 0; k < tables.size(); k++) {
+            //exact value of the term at the start of the block
+            Complex z = Complex(tables.ampRe[k], tables.ampIm[k]) *
+                    exp(-tables.damp[k] * t) * std::polar(1.0, tables.freq[k] * t);
+            double zr = z.real(), zi = z.imag();
+            const double *pr = &tables.powRe[k*BLOCK];
+            const double *pi = &tables.powIm[k*BLOCK];
+
+            for (size_t j = 0; j < BLOCK; j++) {
+                x[j] += zr*pr[j] - zi*pi[j];
+                y[j] += zr*pi[j] + zi*pr[j];
+            }
+        }
+    }
+
+private:
+    TermTables<N> tables;
+};
+
+///
+///Creates a generator for chain, specialised at compile time for chains of
+///up to six terms. The caller owns the returned generator.
+///
+CurveGenerator *makeGenerator(const Chain &chain, double h);
+
+/**
+ * Measures per point cost of PHASOR and DIRECT generation, and of the fixed
+ * size and runtime sized generators, along with the maximum distance between
+ * PHASOR and DIRECT over the given number of steps. Results are written to
+ * out.
+ */
+void benchmarkCurve(const Chain &chain, double h, uint64_t steps, std::ostream &out);
+
+/**
+ * Reports how far a float accumulator of dt has drifted after the given
+ * number of steps, for comparison with the integer step time used here.
+ */
+void benchmarkTimeDrift(double dt, uint64_t steps, std::ostream &out);
+
+#endif /* CURVE_HPP_ */
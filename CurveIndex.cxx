@@ -0,0 +1,373 @@
+/*
+ * File: CurveIndex.cxx
+ * Description: Spatial index over the segments of a curve, for picking.
+ */
+
+#include "CurveIndex.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <limits>
+using namespace std;
+
+const uint32_t CurveIndex::RUN;
+const int CurveIndex::MAX_CELLS;
+
+CurveIndex::CurveIndex(const CurveStore &points) : points(points) {
+    reset(Chain(1, Term(1)), 0);
+}
+
+void CurveIndex::reset(const Chain &chain, double h) {
+    //No segment can be longer than h times the fastest the curve moves, and
+    //most are much shorter. Cells half a run of the longest across keep most
+    //segments to one cell and small enough that the 1/255 steps of a run's
+    //box still hug the curve.
+    double speed = 0;
+    for (size_t k = 0; k < chain.size(); k++) {
+        speed += abs(chain[k].amp) * abs(Complex(-chain[k].damp, chain[k].freq));
+    }
+    float extent = max(chainExtent(chain), 1e-6);
+    cellSize = max(RUN / 2 * speed * abs(h), 2.0 * extent / MAX_CELLS);
+    cells = min(MAX_CELLS, int(ceil(2 * extent / cellSize)));
+    x0 = y0 = -0.5f * cells * cellSize;
+
+    grid.clear();
+    grid.resize(size_t(cells) * cells);
+    runs = 0;
+    indexed = 0;
+}
+
+int CurveIndex::cellX(float x) const {
+    return min(cells - 1, max(0, int(floor((x - x0) / cellSize))));
+}
+
+int CurveIndex::cellY(float y) const {
+    return min(cells - 1, max(0, int(floor((y - y0) / cellSize))));
+}
+
+size_t CurveIndex::Cell::runSize(size_t r) const {
+    //each run has one more point than it has segments
+    size_t end = r + 1 < runs.size() ? runs[r + 1].at : xy.size() / 2;
+    return end - runs[r].at - 1;
+}
+
+void CurveIndex::update() {
+    size_t total = points.size();
+
+    for (; indexed + 1 < total; indexed++) {
+        const float *v = points.segment(indexed);
+        int ix0 = cellX(min(v[0], v[3])), ix1 = cellX(max(v[0], v[3]));
+        int iy0 = cellY(min(v[1], v[4])), iy1 = cellY(max(v[1], v[4]));
+        for (int iy = iy0; iy <= iy1; iy++) {
+            for (int ix = ix0; ix <= ix1; ix++) {
+                if (!addSegment(grid[size_t(iy) * cells + ix], ix, iy, indexed, v, v + 3)) {
+                    cerr << "**ERROR** CurveIndex::update: Cell full, only the first "
+                         << indexed << " segments are indexed" << endl;
+                    indexed = total; //stop here for good
+                    return;
+                }
+            }
+        }
+    }
+}
+
+//position of v within [lo, lo + size] in 1/255ths, rounded down or up
+static uint8_t quantize(float v, float lo, float size, bool up) {
+    float q = (v - lo) / size * 255;
+    q = up ? ceil(q) : floor(q);
+    return uint8_t(min(255.0f, max(0.0f, q)));
+}
+
+//Adds segment s from a to b to the cell, continuing the cell's last run if
+//s follows it. Returns false if the cell has no room for more points.
+bool CurveIndex::addSegment(Cell &cell, int ix, int iy, size_t s, const float *a, const float *b) {
+    if (cell.xy.size() / 2 + 2 > UINT32_MAX) return false;
+
+    //only the part of the box in this cell, the rest is recorded in the
+    //cells it is in
+    float cx = x0 + ix*cellSize, cy = y0 + iy*cellSize;
+    uint8_t box[4] = {
+        quantize(min(a[0], b[0]), cx, cellSize, false),
+        quantize(min(a[1], b[1]), cy, cellSize, false),
+        quantize(max(a[0], b[0]), cx, cellSize, true),
+        quantize(max(a[1], b[1]), cy, cellSize, true)
+    };
+
+    size_t last = cell.runs.size() - 1;
+    if (!cell.runs.empty() && cell.runs[last].first + cell.runSize(last) == s
+            && cell.runSize(last) < RUN) {
+        //the previous segment ended the last run, so s carries it on
+        uint8_t *r = cell.runs[last].box;
+        r[0] = min(r[0], box[0]);
+        r[1] = min(r[1], box[1]);
+        r[2] = max(r[2], box[2]);
+        r[3] = max(r[3], box[3]);
+    } else {
+        Run run = { s, uint32_t(cell.xy.size() / 2), { box[0], box[1], box[2], box[3] } };
+        cell.runs.push_back(run);
+        cell.xy.push_back(a[0]);
+        cell.xy.push_back(a[1]);
+        ++runs;
+    }
+    cell.xy.push_back(b[0]);
+    cell.xy.push_back(b[1]);
+    return true;
+}
+
+//distance from (x, y) to the segment from a to b, with the closest point at
+//a + u (b - a)
+static float segmentDistance(const float *a, const float *b, float x, float y, float &u) {
+    float dx = b[0] - a[0], dy = b[1] - a[1];
+    float len2 = dx*dx + dy*dy;
+    u = 0;
+    if (len2 > 0) {
+        u = min(1.0f, max(0.0f, ((x - a[0])*dx + (y - a[1])*dy) / len2));
+    }
+    float px = a[0] + u*dx - x, py = a[1] + u*dy - y;
+    return sqrt(px*px + py*py);
+}
+
+//whether the segment from a to b comes within sqrt(r2) of (x, y), without
+//the division and square root of segmentDistance()
+static bool segmentWithin(const float *a, const float *b, float x, float y, float r2) {
+    float dx = b[0] - a[0], dy = b[1] - a[1];
+    float ax = x - a[0], ay = y - a[1];
+    float along = ax*dx + ay*dy;
+    if (along <= 0) return ax*ax + ay*ay <= r2;
+    float len2 = dx*dx + dy*dy;
+    if (along >= len2) {
+        float bx = x - b[0], by = y - b[1];
+        return bx*bx + by*by <= r2;
+    }
+    float across = ax*dy - ay*dx;
+    return across*across <= r2 * len2;
+}
+
+void CurveIndex::searchCell(int ix, int iy, float x, float y, float &best, Hit &hit) const {
+    //work in 1/255ths of the cell from its corner
+    float scale = 255 / cellSize;
+    float qx = (x - x0 - ix*cellSize) * scale, qy = (y - y0 - iy*cellSize) * scale;
+
+    //skip cells that are further away than the best segment so far
+    float dx = max(0.0f, max(-qx, qx - 255));
+    float dy = max(0.0f, max(-qy, qy - 255));
+    float reach = best * scale;
+    if (dx*dx + dy*dy > reach*reach) return;
+
+    const Cell &cell = grid[size_t(iy) * cells + ix];
+    for (size_t r = 0; r < cell.runs.size(); r++) {
+        const uint8_t *b = cell.runs[r].box;
+        dx = max(0.0f, max(b[0] - qx, qx - b[2]));
+        dy = max(0.0f, max(b[1] - qy, qy - b[3]));
+        if (dx*dx + dy*dy > reach*reach) continue;
+
+        const float *p = &cell.xy[2 * size_t(cell.runs[r].at)];
+        size_t n = cell.runSize(r);
+        for (size_t i = 0; i < n; i++, p += 2) {
+            //a little slack so rounding never skips a tie, segmentDistance()
+            //has the last word
+            if (!segmentWithin(p, p + 2, x, y, 1.0001f * best*best)) continue;
+            float u;
+            float d = segmentDistance(p, p + 2, x, y, u);
+            if (d <= best) {
+                best = d;
+                hit.segment = cell.runs[r].first + i;
+                hit.u = u;
+                hit.x = p[0] + u*(p[2] - p[0]);
+                hit.y = p[1] + u*(p[3] - p[1]);
+                hit.dist = d;
+            }
+        }
+        reach = best * scale;
+    }
+}
+
+bool CurveIndex::nearest(float x, float y, float maxDist, Hit &hit) const {
+    float best = maxDist;
+    hit.dist = numeric_limits<float>::infinity();
+
+    //Search rings of cells around the query point, nearest first. Cells in
+    //ring k are at least k-1 cells beyond the edge of the centre cell, so
+    //stop once that is further than the best segment found.
+    int cx = cellX(x), cy = cellY(y);
+    float ex = max(0.0f, max(x0 + cx*cellSize - x, x - x0 - (cx+1)*cellSize));
+    float ey = max(0.0f, max(y0 + cy*cellSize - y, y - y0 - (cy+1)*cellSize));
+    float outside = sqrt(ex*ex + ey*ey); //distance to the centre cell
+    for (int k = 0; k < cells; k++) {
+        if (k > 0 && (k-1) * cellSize - outside > best) break;
+
+        int ix0 = max(0, cx - k), ix1 = min(cells - 1, cx + k);
+        int iy0 = max(0, cy - k), iy1 = min(cells - 1, cy + k);
+        for (int iy = iy0; iy <= iy1; iy++) {
+            //only the border of the ring, the inside has been searched
+            if (iy == cy - k || iy == cy + k) {
+                for (int ix = ix0; ix <= ix1; ix++) {
+                    searchCell(ix, iy, x, y, best, hit);
+                }
+            } else {
+                if (cx - k >= 0) searchCell(cx - k, iy, x, y, best, hit);
+                if (cx + k < cells) searchCell(cx + k, iy, x, y, best, hit);
+            }
+        }
+    }
+    return hit.dist <= maxDist;
+}
+
+void CurveIndex::within(float x, float y, float radius, vector<size_t> &segments) const {
+    float scale = 255 / cellSize, r2 = radius*radius;
+    float left = x - radius, bottom = y - radius;
+    int ix0 = cellX(left), iy0 = cellY(bottom);
+    int ix1 = cellX(x + radius), iy1 = cellY(y + radius);
+    for (int iy = iy0; iy <= iy1; iy++) {
+        for (int ix = ix0; ix <= ix1; ix++) {
+            float qx0 = (left - x0 - ix*cellSize) * scale;
+            float qy0 = (bottom - y0 - iy*cellSize) * scale;
+            float qx1 = qx0 + 2 * radius * scale, qy1 = qy0 + 2 * radius * scale;
+
+            const Cell &cell = grid[size_t(iy) * cells + ix];
+            for (size_t r = 0; r < cell.runs.size(); r++) {
+                const uint8_t *b = cell.runs[r].box;
+                if (b[0] > qx1 || b[2] < qx0 || b[1] > qy1 || b[3] < qy0) continue;
+
+                const float *p = &cell.xy[2 * size_t(cell.runs[r].at)];
+                size_t n = cell.runSize(r);
+                for (size_t i = 0; i < n; i++, p += 2) {
+                    if (!segmentWithin(p, p + 2, x, y, r2)) continue;
+
+                    //A segment in several cells of the query is only taken
+                    //from the first of them: the one holding the lower left
+                    //corner of what its box and the query's have in common.
+                    //It starts in this cell or the query does.
+                    if (ix > ix0 && (min(p[0], p[2]) - x0) / cellSize < ix) continue;
+                    if (iy > iy0 && (min(p[1], p[3]) - y0) / cellSize < iy) continue;
+                    segments.push_back(cell.runs[r].first + i);
+                }
+            }
+        }
+    }
+}
+
+size_t CurveIndex::memory() const {
+    size_t bytes = grid.capacity() * sizeof(Cell);
+    for (size_t i = 0; i < grid.size(); i++) {
+        bytes += grid[i].runs.capacity() * sizeof(Run) + grid[i].xy.capacity() * sizeof(float);
+    }
+    return bytes;
+}
+
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+//writes the mean, 99th percentile and worst of times given in seconds
+static void printTimes(vector<double> &times, ostream &out) {
+    double total = 0;
+    for (size_t i = 0; i < times.size(); i++) total += times[i];
+    sort(times.begin(), times.end());
+    out << 1e6 * total / times.size() << " us mean, "
+        << 1e6 * times[times.size() * 99 / 100] << " us 99%, "
+        << 1e6 * times.back() << " us worst";
+}
+
+void benchmarkIndex(const Chain &chain, double h, size_t count, ostream &out) {
+    CurveStore points;
+    CurveGenerator *curve = makeGenerator(chain, h);
+    CurveIndex index(points);
+    index.reset(chain, h);
+
+    //points arrive a few at a time, the way the animation adds them
+    const size_t batch = 64;
+    double indexTime = 0, worstUpdate = 0;
+    for (size_t i = 0; i < count; i += batch) {
+        size_t m = min(batch, count - i);
+        while (m > 0) {
+            size_t n = m;
+            float *p = points.reserve(n);
+            curve->generate(n, p);
+            points.added(n);
+            m -= n;
+        }
+
+        double start = seconds();
+        index.update();
+        double t = seconds() - start;
+        indexTime += t;
+        worstUpdate = max(worstUpdate, t);
+    }
+    delete curve;
+
+    out << count << " points: index built in " << 1e3 * indexTime << " ms ("
+        << 1e9 * indexTime / count << " ns/point, " << 1e6 * worstUpdate
+        << " us worst update), " << index.runCount() << " runs, "
+        << index.memory() / (1024*1024) << " MB" << endl;
+
+    //random query points over the curve's bounding square, and points near
+    //the curve as when hovering over it
+    const int queries = 1000;
+    const float e = chainExtent(chain), pickDist = 0.01f * e;
+    vector<float> qx(queries), qy(queries), px(queries), py(queries);
+    srand(1);
+    for (int q = 0; q < queries; q++) {
+        qx[q] = e * (2.0f * rand() / RAND_MAX - 1);
+        qy[q] = e * (2.0f * rand() / RAND_MAX - 1);
+        size_t v = size_t(double(rand()) / RAND_MAX * (count - 1));
+        px[q] = points.point(v)[0] + pickDist * (float(rand()) / RAND_MAX - 0.5f);
+        py[q] = points.point(v)[1] + pickDist * (float(rand()) / RAND_MAX - 0.5f);
+    }
+
+    vector<double> times(queries);
+    vector<CurveIndex::Hit> hits(queries);
+    for (int q = 0; q < queries; q++) {
+        double start = seconds();
+        index.nearest(qx[q], qy[q], numeric_limits<float>::infinity(), hits[q]);
+        times[q] = seconds() - start;
+    }
+    out << "  nearest segment: ";
+    printTimes(times, out);
+    out << endl;
+
+    CurveIndex::Hit hit;
+    for (int q = 0; q < queries; q++) {
+        double start = seconds();
+        index.nearest(px[q], py[q], pickDist, hit);
+        times[q] = seconds() - start;
+    }
+    out << "  pick within " << pickDist << ": ";
+    printTimes(times, out);
+    out << endl;
+
+    vector<size_t> found;
+    size_t segments = 0;
+    for (int q = 0; q < queries; q++) {
+        found.clear();
+        double start = seconds();
+        index.within(px[q], py[q], pickDist, found);
+        times[q] = seconds() - start;
+        segments += found.size();
+    }
+    out << "  all within " << pickDist << ": ";
+    printTimes(times, out);
+    out << ", " << double(segments) / queries << " segments per query" << endl;
+
+    //check a few queries against a linear scan of every segment
+    const int scans = 20;
+    double scanTime = 0;
+    int mismatches = 0;
+    for (int q = 0; q < scans; q++) {
+        double start = seconds();
+        float best = numeric_limits<float>::infinity(), u;
+        for (size_t s = 0; s + 1 < count; s++) {
+            const float *a = points.segment(s);
+            best = min(best, segmentDistance(a, a + 3, qx[q], qy[q], u));
+        }
+        scanTime += seconds() - start;
+        if (best != hits[q].dist) ++mismatches;
+    }
+    out << "  linear scan: " << 1e3 * scanTime / scans << " ms per query, "
+        << mismatches << " of " << scans << " answers differ" << endl;
+}
@@ -0,0 +1,124 @@
+/*
+ * File: CurveIndex.hpp
+ * Description: Spatial index over the segments of a curve, for picking.
+ */
+
+#ifndef CURVEINDEX_HPP_
+#define CURVEINDEX_HPP_
+
+#include "Curve.hpp"
+#include "CurveStore.hpp"
+
+#include <ostream>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Uniform grid over the line strip through the points of a CurveStore,
+ * answering nearest segment and radius queries in the z = 0 plane.
+ *
+ * Each cell keeps its own copy of the x and y of the points of every segment
+ * that crosses it, as runs of up to RUN consecutive segments, one after the
+ * other in a single array. Each run also has the part of its bounding box
+ * inside the cell, stored to 1/255 of a cell, so queries can reject most runs
+ * of a cell without looking at their points. A query then only reads the
+ * arrays of the cells around it, never the store, whose points for one
+ * place are spread over the whole curve and cost a cache miss each. Cells
+ * are about RUN / 2 of the longest segments across, so most segments are only
+ * in one cell. A query still reads every pass of the curve through the
+ * cells around it, so curves that go over themselves many times are
+ * slower to query than ones that don't.
+ *
+ * The index is built incrementally: update() indexes whatever has been
+ * appended to the store since the last call, continuing the last run of a
+ * cell where the curve carries on in it.
+ */
+class CurveIndex {
+public:
+    static const uint32_t RUN = 8; //most segments per run
+    static const int MAX_CELLS = 512; //most cells along each side of the grid
+
+    /**
+     * Result of a nearest segment query.
+     */
+    struct Hit {
+        size_t segment; //segment from vertex segment to segment+1
+        float u; //position of the closest point along the segment, 0 to 1
+        float x, y; //closest point
+        float dist; //distance from the query point
+    };
+
+    /**
+     * Indexes the line strip through points, which must outlive the index.
+     */
+    CurveIndex(const CurveStore &points);
+
+    /**
+     * Empties the index and sizes the grid for the given chain sampled every
+     * h. Cells are made about RUN / 2 times as large as the longest possible
+     * segment, or 1/MAX_CELLS of the curve's extent if that is larger.
+     */
+    void reset(const Chain &chain, double h);
+
+    /**
+     * Indexes the segments added to the store since the last call. The store
+     * must only have grown since then. A cell holds up to 2^32 points, after
+     * which an error is printed and no more segments are indexed.
+     */
+    void update();
+
+    /**
+     * Finds the segment closest to (x, y) no further away than maxDist.
+     *
+     * @return true if one was found, with the details in hit
+     */
+    bool nearest(float x, float y, float maxDist, Hit &hit) const;
+
+    /**
+     * Appends every segment within radius of (x, y) to segments, each once
+     * and in no particular order.
+     */
+    void within(float x, float y, float radius, std::vector<size_t> &segments) const;
+
+    size_t segments() const { return indexed; } //segments indexed so far
+    size_t runCount() const { return runs; }
+    size_t memory() const; //bytes used by the index
+
+private:
+    struct Run {
+        uint64_t first; //first segment
+        uint32_t at; //first point in the cell's points
+        uint8_t box[4]; //x0, y0, x1, y1 of the run within the cell
+    };
+
+    struct Cell {
+        std::vector<Run> runs; //runs crossing the cell, in the order added
+        std::vector<float> xy; //points of each run in turn, x and y of each
+        size_t runSize(size_t r) const; //segments in run r
+    };
+
+    int cellX(float x) const;
+    int cellY(float y) const;
+    bool addSegment(Cell &cell, int ix, int iy, size_t s, const float *a, const float *b);
+    void searchCell(int ix, int iy, float x, float y, float &best, Hit &hit) const;
+
+    const CurveStore &points;
+
+    float x0, y0; //corner of the grid
+    float cellSize;
+    int cells; //along each side
+
+    std::vector<Cell> grid;
+    size_t runs;
+
+    size_t indexed; //segments before this are in the grid
+};
+
+/**
+ * Generates points of chain a frame's worth at a time while indexing them,
+ * then times nearest segment and radius queries at random points against a
+ * linear scan. Results are written to out.
+ */
+void benchmarkIndex(const Chain &chain, double h, size_t count, std::ostream &out);
+
+#endif /* CURVEINDEX_HPP_ */
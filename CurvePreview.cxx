@@ -0,0 +1,183 @@
+/*
+ * File: CurvePreview.cxx
+ * Description: Coarse picture of a whole curve, refined a little at a time.
+ */
+
+#include "CurvePreview.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+using namespace std;
+
+const size_t CurvePreview::COARSE;
+const size_t CurvePreview::MAX;
+const size_t CurvePreview::BLOCK;
+const double CurvePreview::ANGLE = 0.5;
+
+CurvePreview::CurvePreview() : h(1), t1(0), dt(0), longest(0), pending(false), levels(0),
+        nextLongest(0), curve(NULL) {
+}
+
+CurvePreview::~CurvePreview() {
+    delete curve;
+}
+
+void CurvePreview::reset(const Chain &chain, double h) {
+    terms = chain;
+    this->h = fabs(h);
+    pending = true;
+    delete curve;
+    curve = NULL;
+    xyz.clear();
+    boxes.clear();
+    longest = 0;
+    next.clear();
+    nextBoxes.clear();
+    nextLongest = 0;
+}
+
+void CurvePreview::coarse(size_t budget) {
+    double fastest = 0, slowestDecay = 0;
+    for (size_t k = 0; k < terms.size(); k++) {
+        fastest = max(fastest, fabs(terms[k].freq));
+        if (terms[k].damp > 0 && (0 == slowestDecay || terms[k].damp < slowestDecay)) {
+            slowestDecay = terms[k].damp;
+        }
+    }
+
+    //the longest span the first level can show without the fastest term
+    //turning more than ANGLE a step, in no more points than one frame makes
+    size_t most = max(min(COARSE, budget), size_t(17));
+    double limit = fastest > 0 ? most * ANGLE / fastest : 2 * M_PI;
+    if (slowestDecay > 0) {
+        //never repeats, but is down to under 1% of its size after 5 / d
+        t1 = min(limit, 5 / slowestDecay);
+    } else {
+        t1 = chainPeriod(terms, limit, 1e-3 * chainExtent(terms));
+    }
+
+    //no finer than the animation, and at least enough steps to show a circle
+    size_t steps = size_t(min(double(most - 1), ceil(t1 / max(h, 1e-12))));
+    steps = max(steps, size_t(16));
+    dt = t1 / steps;
+    levels = 0;
+
+    CurveGenerator *points = makeGenerator(terms, dt);
+    slice.resize(3 * (steps + 1));
+    points->generate(steps + 1, slice.data());
+    delete points;
+    next.reserve(slice.size());
+    for (size_t k = 0; k <= steps; k++) append(&slice[3 * k]);
+    finishLevel();
+    startLevel();
+}
+
+void CurvePreview::startLevel() {
+    delete curve;
+    curve = NULL;
+    size_t steps = size() - 1;
+    if (dt / 2 < h || 2 * steps + 1 > MAX) return;
+
+    //point k of the shifted curve is halfway between points k and k + 1
+    curve = makeGenerator(shiftChain(terms, dt / 2), dt);
+    next.reserve(3 * (2 * steps + 1));
+}
+
+void CurvePreview::finishLevel() {
+    xyz.swap(next);
+    boxes.swap(nextBoxes);
+    longest = sqrt(nextLongest);
+    next.clear();
+    nextBoxes.clear();
+    nextLongest = 0;
+}
+
+//adds p to the end of the next level, the boxes of the blocks it is in or
+//leads into and its step to the longest
+void CurvePreview::append(const float *p) {
+    size_t i = next.size() / 3;
+    if (i > 0) {
+        const float *q = &next[next.size() - 3];
+        float dx = p[0] - q[0], dy = p[1] - q[1];
+        nextLongest = max(nextLongest, dx*dx + dy*dy);
+    }
+    next.insert(next.end(), p, p + 3);
+
+    for (size_t b = i / BLOCK; b <= (i + 2) / BLOCK; b++) {
+        if (b == nextBoxes.size()) {
+            Box start = { { p[0], p[1], p[2] }, { p[0], p[1], p[2] } };
+            nextBoxes.push_back(start);
+            continue;
+        }
+        Box &box = nextBoxes[b];
+        for (int k = 0; k < 3; k++) {
+            box.lo[k] = min(box.lo[k], p[k]);
+            box.hi[k] = max(box.hi[k], p[k]);
+        }
+    }
+}
+
+bool CurvePreview::refine(size_t budget, double chord) {
+    if (pending) {
+        pending = false;
+        coarse(budget);
+        return true;
+    }
+    if (!curve) return false;
+
+    //fine enough for the view, until it zooms in
+    if (longest <= chord) return false;
+
+    size_t steps = size() - 1, made = next.size() / 6;
+    size_t n = min(budget, steps - made);
+    slice.resize(3 * n);
+    curve->generate(n, slice.data());
+    for (size_t k = 0; k < n; k++) {
+        append(&xyz[3 * (made + k)]);
+        append(&slice[3 * k]);
+    }
+    if (made + n < steps) return false;
+
+    //every step has its halfway point, so the next level is complete
+    append(&xyz[xyz.size() - 3]);
+    finishLevel();
+    dt /= 2;
+    ++levels;
+    startLevel();
+    return true;
+}
+
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+void benchmarkPreview(const Chain &chain, double h, size_t perFrame, int pixels, ostream &out) {
+    CurvePreview preview;
+    preview.reset(chain, h);
+    double chord = 2 * chainExtent(chain) / pixels;
+
+    //the frames spent on each level, up to the one that completes it
+    double total = 0, worst = 0;
+    size_t frames = 0;
+    while (0 == preview.size() || (!preview.done() && preview.chord() > chord)) {
+        double start = seconds();
+        bool changed = preview.refine(perFrame, chord);
+        double t = seconds() - start;
+        total += t;
+        worst = max(worst, t);
+        ++frames;
+        if (!changed) continue;
+        if (0 == preview.level()) {
+            out << chain.size() << " terms: span t = " << preview.span() << ", chord of a pixel "
+                << chord << endl;
+        }
+        out << "  level " << preview.level() << ": " << preview.size() << " points, step "
+            << preview.step() << ", longest chord " << preview.chord() << ", " << frames
+            << " frames, " << 1e3 * total << " ms (" << 1e3 * worst << " ms worst frame)" << endl;
+        total = worst = 0;
+        frames = 0;
+    }
+}
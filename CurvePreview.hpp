@@ -0,0 +1,126 @@
+/*
+ * File: CurvePreview.hpp
+ * Description: Coarse picture of a whole curve, refined a little at a time.
+ */
+
+#ifndef CURVEPREVIEW_HPP_
+#define CURVEPREVIEW_HPP_
+
+#include "Curve.hpp"
+
+#include <ostream>
+#include <vector>
+
+/**
+ * The whole of a curve sampled coarsely, so its shape can be shown as soon
+ * as the parameters change instead of waiting for the animation to draw it.
+ *
+ * The preview covers one period of the curve, or as much of it as the first
+ * level can show smoothly if it never repeats or takes too long to, or
+ * until the damping has shrunk it to nothing. The first level has at most
+ * COARSE points, or a frame's budget if that is fewer, spaced so the fastest
+ * term turns no more than ANGLE a step where there is room. It is made
+ * whole by the first call to refine(), so the shape shows in the frame
+ * after a change. Each refinement then adds the point halfway along every
+ * step, until the longest step is no longer than the chord the view can
+ * resolve, the steps are as fine as the animation's, or the level would
+ * hold more than MAX points. The halfway points are the curve itself
+ * shifted by half a step, so they come from a generator like any other
+ * points. Each slice is woven in with the points it falls between as it is
+ * made, so finishing a level is only a swap.
+ *
+ * Like a CurveStore, each level is divided into blocks of BLOCK points with
+ * a bounding box, so a view can skip the parts it cannot see. A box also
+ * holds the two points before its block, which the strip drawn from there
+ * starts with.
+ *
+ * Nothing is generated until the first call to refine() after reset(), so
+ * parameters changed many times between frames cost nothing until then, and
+ * a reset drops any level still under way.
+ */
+class CurvePreview {
+public:
+    static const size_t COARSE = 1 << 17; //most points of the first level
+    static const size_t MAX = 1 << 21; //most points of a refined level
+    static const size_t BLOCK = 1024; //points in each block
+    static const double ANGLE; //radians the fastest term turns in a coarse step
+
+    struct Box {
+        float lo[3], hi[3];
+    };
+
+    CurvePreview();
+    ~CurvePreview();
+
+    /**
+     * Starts over with a new curve whose animation uses step h. The points
+     * of the last curve are dropped.
+     */
+    void reset(const Chain &chain, double h);
+
+    /**
+     * Generates the first level, of at most budget points, if it is not made
+     * yet, otherwise up to budget halfway points of the next one if the
+     * longest step of the current level is longer than chord.
+     *
+     * @return true if points() changed
+     */
+    bool refine(size_t budget, double chord);
+
+    ///
+    ///True once no further level will be made, however fine the view.
+    ///
+    bool done() const { return !pending && !curve; }
+
+    ///
+    ///Points of the current level as (x, y, 0) triples in order of t, from
+    ///t = 0 to span(). Empty until the first level is made.
+    ///
+    const std::vector<float> &points() const { return xyz; }
+    size_t size() const { return xyz.size() / 3; }
+
+    size_t blockCount() const { return (size() + BLOCK - 1) / BLOCK; }
+
+    ///
+    ///Bounding box of the points of block b and the two before it.
+    ///
+    const Box &blockBox(size_t b) const { return boxes[b]; }
+
+    double span() const { return t1; }
+    double step() const { return dt; }
+    double chord() const { return longest; } //longest step of the current level
+    int level() const { return levels; } //refinements since the first level
+
+private:
+    //not copyable, the generator belongs to one preview
+    CurvePreview(const CurvePreview &);
+    CurvePreview &operator=(const CurvePreview &);
+
+    void coarse(size_t budget);
+    void startLevel();
+    void finishLevel();
+    void append(const float *p);
+
+    Chain terms;
+    double h; //step of the animation, the finest worth showing
+    double t1, dt; //span and step of the current level, or the first one
+    double longest; //longest step of the current level
+    bool pending; //reset since the first level was made
+    int levels;
+    std::vector<float> xyz; //the current level
+    std::vector<Box> boxes; //blocks of the current level
+    std::vector<float> next; //the next level as far as it is made
+    std::vector<Box> nextBoxes; //blocks of next
+    float nextLongest; //square of the longest step of next
+    std::vector<float> slice; //points just generated
+    CurveGenerator *curve; //makes the next level's points, NULL when done
+};
+
+/**
+ * Times making the first level of a preview of chain and each refinement of
+ * it, perFrame points a frame, in a view pixels across that shows the whole
+ * curve, and reports the span and size of each level.
+ */
+void benchmarkPreview(const Chain &chain, double h, size_t perFrame, int pixels, std::ostream &out);
+
+#endif /* CURVEPREVIEW_HPP_ */
@@ -0,0 +1,144 @@
+/*
+ * File: CurveStore.cxx
+ * Description: Growable point storage for the curve, kept in fixed size chunks.
+ */
+
+#include "CurveStore.hpp"
+#include "Curve.hpp"
+
+#include <algorithm>
+#include <ctime>
+using namespace std;
+
+const size_t CurveStore::CHUNK;
+const size_t CurveStore::OVERLAP;
+const size_t CurveStore::SLOTS;
+const size_t CurveStore::BLOCK;
+const size_t CurveStore::GROUP;
+
+CurveStore::CurveStore() : count(0) {
+}
+
+CurveStore::~CurveStore() {
+    for (size_t k = 0; k < chunks.size(); k++) {
+        delete chunks[k];
+    }
+}
+
+void CurveStore::clear() {
+    count = 0;
+}
+
+//grows box to hold the point at p
+static void extend(CurveStore::Box &box, const float *p) {
+    for (int i = 0; i < 3; i++) {
+        box.lo[i] = min(box.lo[i], p[i]);
+        box.hi[i] = max(box.hi[i], p[i]);
+    }
+}
+
+//grows box to hold other
+static void merge(CurveStore::Box &box, const CurveStore::Box &other) {
+    extend(box, other.lo);
+    extend(box, other.hi);
+}
+
+float *CurveStore::reserve(size_t &n) {
+    size_t k = count / CHUNK, used = count % CHUNK;
+    if (0 == used) {
+        //starting chunk k
+        if (k == chunks.size()) chunks.push_back(new Chunk);
+        float *lead = chunks[k]->points;
+        if (k > 0) {
+            copy(chunks[k-1]->points + 3 * CHUNK, chunks[k-1]->points + 3 * SLOTS, lead);
+        } else {
+            fill(lead, lead + 3 * OVERLAP, 0.0f);
+        }
+    }
+    n = min(n, CHUNK - used);
+    return chunks[k]->points + 3 * (OVERLAP + used);
+}
+
+void CurveStore::added(size_t n) {
+    //the new points follow the two before them in the same chunk, or in its
+    //leading slots
+    const float *p = point(count);
+    size_t end = count + n;
+    while (count < end) {
+        Chunk &c = *chunks[count / CHUNK];
+        Box &block = c.blocks[count % CHUNK / BLOCK];
+        Box &group = c.groups[count % CHUNK / GROUP];
+        if (0 == count % BLOCK) {
+            Box start = { { p[0], p[1], p[2] }, { p[0], p[1], p[2] } };
+            if (count >= 1) extend(start, p - 3);
+            if (count >= 2) extend(start, p - 6);
+            block = start;
+            if (0 == count % GROUP) group = start;
+        }
+
+        //the rest of this block, with the box held locally
+        size_t last = min(end, (count / BLOCK + 1) * BLOCK);
+        Box box = block;
+        for (; count < last; count++, p += 3) {
+            extend(box, p);
+        }
+        block = box;
+        merge(group, box);
+    }
+}
+
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+void benchmarkStore(size_t count, size_t perFrame, ostream &out) {
+    const double h = 0.001;
+    Chain chain = classicChain(0.0893, 1.854, 0.8);
+
+    //the way the curve used to grow
+    CurveGenerator *curve = makeGenerator(chain, h);
+    double total = 0, worst = 0;
+    size_t frames = 0;
+    {
+        vector<float> verts;
+        for (size_t i = 0; i < count; i += perFrame) {
+            size_t n = min(perFrame, count - i);
+            double start = seconds();
+            verts.resize(verts.size() + 3 * n);
+            curve->generate(n, &verts[3 * i]);
+            double t = seconds() - start;
+            total += t;
+            worst = max(worst, t);
+            ++frames;
+        }
+        out << count << " points, " << perFrame << " per frame:" << endl
+            << "  vector:      " << 1e3 * total / frames << " ms mean, "
+            << 1e3 * worst << " ms worst, " << verts.capacity() * sizeof(float) / (1024*1024)
+            << " MB" << endl;
+    }
+    delete curve;
+
+    curve = makeGenerator(chain, h);
+    CurveStore store;
+    total = worst = 0;
+    for (size_t i = 0; i < count; i += perFrame) {
+        size_t left = min(perFrame, count - i);
+        double start = seconds();
+        while (left > 0) {
+            size_t n = left;
+            float *p = store.reserve(n);
+            curve->generate(n, p);
+            store.added(n);
+            left -= n;
+        }
+        double t = seconds() - start;
+        total += t;
+        worst = max(worst, t);
+    }
+    delete curve;
+    out << "  chunk store: " << 1e3 * total / frames << " ms mean, "
+        << 1e3 * worst << " ms worst, " << store.memory() / (1024*1024) << " MB in "
+        << store.chunkCount() << " chunks" << endl;
+}
@@ -0,0 +1,132 @@
+/*
+ * File: CurveStore.hpp
+ * Description: Growable point storage for the curve, kept in fixed size chunks.
+ */
+
+#ifndef CURVESTORE_HPP_
+#define CURVESTORE_HPP_
+
+#include <ostream>
+#include <vector>
+
+/**
+ * The points of a curve as (x, y, z) triples in chunks of CHUNK points.
+ *
+ * Growing never moves points already stored: a full chunk is left as it is
+ * and the next points go in a new one, so there is no copy of the whole
+ * curve when it outgrows its storage the way a vector has. Only the last
+ * chunk is ever written to.
+ *
+ * Each chunk starts with OVERLAP slots repeating the last points of the chunk
+ * before, followed by the chunk's own points. Any chunk can then be drawn as
+ * a line strip on its own that joins up with the one before it, and the two
+ * ends of every segment are next to each other in memory. The first chunk
+ * has nothing before it and its leading slots are zero.
+ *
+ * The curve is also divided into blocks of BLOCK points, and those into
+ * groups of GROUP points, each with a bounding box kept up to date as points
+ * are added, so a view can skip the parts of the curve it cannot see. Groups
+ * are checked first and the blocks of a group only when it is partly in
+ * view. A box also holds the two points before its block or group, which the
+ * strip drawn from there starts with. The boxes are kept with the chunk, so
+ * they never move either.
+ */
+class CurveStore {
+public:
+    static const size_t CHUNK = 1 << 16; //points owned by each chunk
+    static const size_t OVERLAP = 3; //points of the chunk before repeated first
+    static const size_t SLOTS = OVERLAP + CHUNK; //points stored per chunk
+    static const size_t BLOCK = 32; //points in each block
+    static const size_t GROUP = 1024; //points in each group, divides CHUNK
+
+    struct Box {
+        float lo[3], hi[3];
+    };
+
+    CurveStore();
+    ~CurveStore();
+
+    /**
+     * Removes every point. The chunks are kept to be filled again.
+     */
+    void clear();
+
+    /**
+     * Returns where the next point goes and lowers n, if needed, to the
+     * number of points that fit there before the chunk is full. Write the
+     * points and call added().
+     */
+    float *reserve(size_t &n);
+
+    /**
+     * Adds the n points written after the last call to reserve().
+     */
+    void added(size_t n);
+
+    size_t size() const { return count; }
+    size_t chunkCount() const { return (count + CHUNK - 1) / CHUNK; }
+
+    /**
+     * Points owned by chunk k, CHUNK for all but the last.
+     */
+    size_t chunkSize(size_t k) const { return k + 1 < chunkCount() ? CHUNK : count - k * CHUNK; }
+
+    /**
+     * The SLOTS points of chunk k, starting with the ones it repeats.
+     */
+    const float *chunk(size_t k) const { return chunks[k]->points; }
+
+    /**
+     * Point i of the curve.
+     */
+    const float *point(size_t i) const {
+        return chunks[i / CHUNK]->points + 3 * (OVERLAP + i % CHUNK);
+    }
+
+    /**
+     * Point s followed by point s + 1, which must exist.
+     */
+    const float *segment(size_t s) const {
+        //the last point of a chunk is repeated just before the next one's
+        if (s % CHUNK == CHUNK - 1) return chunks[s / CHUNK + 1]->points + 3 * (OVERLAP - 1);
+        return point(s);
+    }
+
+    size_t blockCount() const { return (count + BLOCK - 1) / BLOCK; }
+    size_t groupCount() const { return (count + GROUP - 1) / GROUP; }
+
+    ///
+    ///Bounding box of the points of block or group b and the two before it.
+    ///
+    const Box &blockBox(size_t b) const {
+        return chunks[b / (CHUNK / BLOCK)]->blocks[b % (CHUNK / BLOCK)];
+    }
+    const Box &groupBox(size_t g) const {
+        return chunks[g / (CHUNK / GROUP)]->groups[g % (CHUNK / GROUP)];
+    }
+
+    size_t memory() const { return chunks.size() * sizeof(Chunk); }
+
+private:
+    //not copyable, the chunks belong to one store
+    CurveStore(const CurveStore &);
+    CurveStore &operator=(const CurveStore &);
+
+    struct Chunk {
+        float points[3 * SLOTS];
+        Box blocks[CHUNK / BLOCK];
+        Box groups[CHUNK / GROUP];
+    };
+
+    std::vector<Chunk *> chunks; //every chunk allocated, used or not
+    size_t count;
+};
+
+/**
+ * Grows a curve to count points, perFrame points at a time, in a vector and
+ * in a CurveStore and reports the mean and worst time each takes to add a
+ * frame's points.
+ */
+void benchmarkStore(size_t count, size_t perFrame, std::ostream &out);
+
+#endif /* CURVESTORE_HPP_ */
@@ -0,0 +1,165 @@
+/*
+ * File: Exposure.cxx
+ * Description: Long exposure images of a curve, built from how often it
+ *   passes through each pixel.
+ */
+
+#include "Exposure.hpp"
+#include "ImageWriter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <functional>
+#include <thread>
+using namespace std;
+
+static const size_t BATCH = 4096; //points generated at a time
+static const uint64_t MAX_RUN = uint64_t(1) << 31; //most samples a layer takes before a merge
+
+const uint64_t Exposure::MIN_RUN = 1 << 20;
+const size_t Exposure::MAX_LAYER_BYTES = size_t(1) << 30;
+
+Exposure::Exposure(int width, int height, double extent) : width(width), height(height) {
+    scale = 0.5 * min(width, height) / extent;
+    density.assign(size_t(width) * height, 0);
+}
+
+void Exposure::expose(const Chain &chain, double h, uint64_t first, uint64_t count, unsigned threads) {
+    if (0 == threads) threads = threadsFor(count);
+    layers.resize(threads);
+    for (size_t l = 0; l < layers.size(); l++) {
+        layers[l].resize(density.size(), 0);
+    }
+
+    while (count > 0) {
+        //A layer only counts up to 2^32 - 1 samples in a pixel, so they are
+        //merged at least every MAX_RUN samples a thread.
+        uint64_t round = min(count, threads * MAX_RUN);
+        vector<thread> workers;
+        for (unsigned k = 1; k < threads; k++) {
+            uint64_t a = round * k / threads, b = round * (k+1) / threads;
+            workers.push_back(thread(&Exposure::exposeRun, this, cref(chain), h,
+                    first + a, b - a, size_t(k)));
+        }
+        exposeRun(chain, h, first, round / threads, 0);
+        for (size_t k = 0; k < workers.size(); k++) workers[k].join();
+        workers.clear();
+
+        //the reduction, a band of rows a thread
+        for (unsigned k = 1; k < threads; k++) {
+            workers.push_back(thread(&Exposure::mergeRows, this,
+                    int(height * k / threads), int(height * (k+1) / threads)));
+        }
+        mergeRows(0, height / threads);
+        for (size_t k = 0; k < workers.size(); k++) workers[k].join();
+
+        first += round;
+        count -= round;
+    }
+}
+
+void Exposure::exposeRun(const Chain &chain, double h, uint64_t first, uint64_t count, size_t layer) {
+    CurveGenerator *curve = makeGenerator(chain, h);
+    curve->seek(first);
+    uint32_t *counts = layers[layer].data();
+    float xyz[3 * BATCH];
+    float cx = 0.5f * width, cy = 0.5f * height, s = scale;
+
+    while (count > 0) {
+        size_t n = size_t(min(count, uint64_t(BATCH)));
+        curve->generate(n, xyz);
+        for (size_t i = 0; i < n; i++) {
+            //pixel of the sample, with y up
+            float px = cx + s * xyz[3*i], py = cy - s * xyz[3*i+1];
+            if (px < 0 || py < 0 || px >= width || py >= height) continue;
+            ++counts[size_t(py) * width + size_t(px)];
+        }
+        count -= n;
+    }
+    delete curve;
+}
+
+void Exposure::mergeRows(int begin, int end) {
+    size_t from = size_t(begin) * width, to = size_t(end) * width;
+    for (size_t l = 0; l < layers.size(); l++) {
+        uint32_t *layer = layers[l].data();
+        for (size_t i = from; i < to; i++) {
+            //saturates rather than wrapping around
+            uint64_t sum = uint64_t(density[i]) + layer[i];
+            density[i] = uint32_t(min(sum, uint64_t(0xffffffffu)));
+            layer[i] = 0;
+        }
+    }
+}
+
+unsigned Exposure::threadsFor(uint64_t samples) const {
+    uint64_t threads = max(1u, thread::hardware_concurrency());
+    threads = min(threads, samples / MIN_RUN);
+    //at least one layer, however large the image
+    threads = min(threads, uint64_t(MAX_LAYER_BYTES / (density.size() * sizeof(uint32_t))));
+    return unsigned(max(threads, uint64_t(1)));
+}
+
+uint32_t Exposure::peak() const {
+    return density.empty() ? 0 : *max_element(density.begin(), density.end());
+}
+
+size_t Exposure::memory() const {
+    return (1 + layers.size()) * density.size() * sizeof(uint32_t);
+}
+
+bool Exposure::write(string file, double gamma) const {
+    PPMWriter out;
+    if (!out.open(file, width, height)) {
+        return false;
+    }
+
+    //log first, so faint passes still show next to the densest crossings
+    double top = log1p(double(peak()));
+    vector<unsigned char> row(size_t(width) * 3);
+    for (int y = 0; y < height; y++) {
+        const uint32_t *d = &density[size_t(y) * width];
+        for (int x = 0; x < width; x++) {
+            double v = top > 0 ? pow(log1p(double(d[x])) / top, 1 / gamma) : 0;
+            row[3*x] = row[3*x+1] = row[3*x+2] = (unsigned char)(255 * v + 0.5);
+        }
+        if (!out.writeRect(0, y, width, 1, row.data())) {
+            return false;
+        }
+    }
+    return out.close();
+}
+
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+bool renderExposure(const Chain &chain, double h, uint64_t samples, int width, int height,
+        string file, ostream &out, atomic<uint64_t> *progress) {
+    //a little room around the curve
+    Exposure image(width, height, 1.05 * chainExtent(chain));
+    unsigned threads = image.threadsFor(samples);
+    double start = seconds();
+    //In slices of about 1% when someone is watching. Each slice ends with a
+    //merge of every layer pixel, so a slice takes at least that many samples.
+    uint64_t slice = samples;
+    if (progress) {
+        slice = max(samples / 100, uint64_t(threads) * width * height);
+    }
+    for (uint64_t taken = 0; taken < samples; taken += slice) {
+        image.expose(chain, h, taken, min(slice, samples - taken), threads);
+        if (progress) *progress = min(taken + slice, samples);
+    }
+    double exposed = seconds() - start;
+    if (!image.write(file)) {
+        return false;
+    }
+    out << "wrote " << width << "x" << height << " exposure of " << samples << " samples to "
+        << file << " in " << exposed << " s (" << samples / exposed / 1e6 << " M samples/s, "
+        << threads << " threads, " << image.memory() / (1024*1024) << " MB, "
+        << image.peak() << " samples in the densest pixel)" << endl;
+    return true;
+}
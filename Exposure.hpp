@@ -0,0 +1,88 @@
+/*
+ * File: Exposure.hpp
+ * Description: Long exposure images of a curve, built from how often it
+ *   passes through each pixel.
+ */
+
+#ifndef EXPOSURE_HPP_
+#define EXPOSURE_HPP_
+
+#include "Curve.hpp"
+
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Counts the samples of a curve that land in each pixel of an image, as if
+ * the pen were a light left on over a long exposure.
+ *
+ * The samples are split into one run of consecutive steps per thread, each
+ * with its own generator started at its first step and its own density
+ * layer the size of the image, so threads never share a pixel. A reduction
+ * then adds the layers into the image, each thread summing a band of rows.
+ * Memory depends only on the image size and the number of threads, never
+ * on how many samples are taken. Fewer threads are used when their layers
+ * would take more than MAX_LAYER_BYTES.
+ */
+class Exposure {
+public:
+    /**
+     * Creates a black image showing the square from (-extent, -extent) to
+     * (extent, extent) of the curve's plane, centered in the image.
+     */
+    Exposure(int width, int height, double extent);
+
+    /**
+     * Adds samples first .. first+count-1 of the curve, at t = n*h.
+     *
+     * @param threads Threads to sample with, 0 for threadsFor(count)
+     */
+    void expose(const Chain &chain, double h, uint64_t first, uint64_t count, unsigned threads = 0);
+
+    /**
+     * Threads worth taking samples samples with: one per core, but none
+     * with fewer than MIN_RUN samples and no more than MAX_LAYER_BYTES of
+     * layers. Pass the whole exposure's samples when it is taken in
+     * several calls to expose().
+     */
+    unsigned threadsFor(uint64_t samples) const;
+
+    /**
+     * Writes the image as a PPM, tone mapped so the densest pixel is white:
+     * each pixel's count d becomes (log(1 + d) / log(1 + peak))^(1 / gamma).
+     *
+     * @return false if the file could not be opened or written
+     */
+    bool write(std::string file, double gamma = 2.2) const;
+
+    uint32_t peak() const; //most samples in one pixel
+    size_t memory() const; //bytes of density counts
+
+    int width, height;
+
+    static const uint64_t MIN_RUN; //fewest samples worth giving a thread
+    static const size_t MAX_LAYER_BYTES; //most memory for the threads' layers
+
+private:
+    void exposeRun(const Chain &chain, double h, uint64_t first, uint64_t count, size_t layer);
+    void mergeRows(int begin, int end);
+
+    double scale; //pixels per unit of the curve's plane
+    std::vector<uint32_t> density; //samples in each pixel, top row first
+    std::vector<std::vector<uint32_t> > layers; //each thread's counts since the last merge
+};
+
+/**
+ * Takes samples samples of chain with step h into a width x height
+ * exposure, writes it to file and reports the sampling rate to out.
+ *
+ * @param progress If not NULL, set to the samples taken so far as they are
+ *        taken, so another thread can show how far the exposure has got
+ */
+bool renderExposure(const Chain &chain, double h, uint64_t samples, int width, int height,
+        std::string file, std::ostream &out, std::atomic<uint64_t> *progress = NULL);
+
+#endif /* EXPOSURE_HPP_ */
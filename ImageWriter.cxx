@@ -0,0 +1,83 @@
+/*
+ * File: ImageWriter.cxx
+ * Description: Writes images to disk a piece at a time.
+ */
+
+#include "ImageWriter.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <sys/types.h>
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+//class PPMWriter
+
+PPMWriter::PPMWriter() {
+    fout = NULL;
+    width = height = 0;
+    dataStart = 0;
+}
+
+PPMWriter::~PPMWriter() {
+    close();
+}
+
+bool PPMWriter::open(string file, int width, int height) {
+    close();
+    fout = fopen(file.c_str(), "wb");
+    if (!fout) {
+        cerr << "**ERROR** PPMWriter::open: Couldn't open " << file
+             << " for writing" << endl;
+        return false;
+    }
+    this->width = width;
+    this->height = height;
+    fprintf(fout, "P6\n%d %d\n255\n", width, height);
+    dataStart = ftell(fout);
+    return true;
+}
+
+bool PPMWriter::writeRect(int x, int y, int w, int h, const unsigned char *rgb) {
+    for (int row = 0; row < h; row++) {
+        //off_t so images over 2GB can be addressed
+        off_t offset = dataStart + (off_t(y + row) * width + x) * 3;
+        if (0 != fseeko(fout, offset, SEEK_SET)) {
+            cerr << "**ERROR** PPMWriter::writeRect: Couldn't seek to row " << y + row
+                 << ": " << strerror(errno) << endl;
+            return false;
+        }
+        if (fwrite(rgb + size_t(row) * w * 3, 3, w, fout) != size_t(w)) {
+            cerr << "**ERROR** PPMWriter::writeRect: Couldn't write row " << y + row
+                 << ": " << strerror(errno) << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PPMWriter::writeRectFlipped(int x, int y, int w, int h, const unsigned char *rgb) {
+    for (int row = 0; row < h; row++) {
+        if (!writeRect(x, y + row, w, 1, rgb + size_t(h - 1 - row) * w * 3)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PPMWriter::close() {
+    if (!fout) {
+        return true;
+    }
+    bool ok = 0 == fclose(fout);
+    fout = NULL;
+    if (!ok) {
+        cerr << "**ERROR** PPMWriter::close: Couldn't finish writing the image: "
+             << strerror(errno) << endl;
+    }
+    return ok;
+}
+
+//
+////////////////////////////////////////////////////////////////////////////////
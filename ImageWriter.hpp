@@ -0,0 +1,60 @@
+/*
+ * File: ImageWriter.hpp
+ * Description: Writes images to disk a piece at a time.
+ */
+
+#ifndef IMAGEWRITER_HPP_
+#define IMAGEWRITER_HPP_
+
+#include <cstdio>
+#include <string>
+
+/**
+ * Writes a binary (P6) PPM image. Rows are stored uncompressed at fixed
+ * offsets, so any rectangle of the image can be written on its own and the
+ * whole image never needs to be held in memory.
+ */
+class PPMWriter {
+public:
+    PPMWriter();
+    ~PPMWriter();
+
+    /**
+     * Creates the file and writes the header.
+     *
+     * @return false if the file could not be opened
+     */
+    bool open(std::string file, int width, int height);
+
+    /**
+     * Writes a w by h block of RGB pixels with its top left corner at (x, y).
+     *
+     * @param rgb Tightly packed rows, top row first
+     * @return false if a seek or write failed, e.g. with the disk full
+     */
+    bool writeRect(int x, int y, int w, int h, const unsigned char *rgb);
+
+    /**
+     * Writes a w by h block of RGB pixels as read back by glReadPixels, i.e.
+     * with the bottom row first. (x, y) is still the top left corner in the
+     * image.
+     *
+     * @return false if a seek or write failed
+     */
+    bool writeRectFlipped(int x, int y, int w, int h, const unsigned char *rgb);
+
+    /**
+     * Closes the file, flushing what is left of it.
+     *
+     * @return false if the flush failed, so the image is incomplete
+     */
+    bool close();
+
+    int width, height;
+
+private:
+    FILE *fout;
+    long dataStart; //offset of the first pixel
+};
+
+#endif /* IMAGEWRITER_HPP_ */
@@ -0,0 +1,279 @@
+/*
+ * File: Recorder.cxx
+ * Description: Records user input to a file and plays it back.
+ */
+
+#include "Recorder.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+using namespace std;
+
+static const char MAGIC[4] = { 'S', 'P', 'R', 'C' };
+static const uint32_t VERSION = 1;
+
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//class Recorder
+
+Recorder::Recorder() {
+    file = NULL;
+    writing = false;
+    error = false;
+    lastFrame = 0;
+}
+
+Recorder::~Recorder() {
+    close();
+}
+
+bool Recorder::record(string name) {
+    close();
+    file = fopen(name.c_str(), "wb");
+    if (!file) {
+        cerr << "**ERROR** Recorder::record: Couldn't open " << name
+             << " for writing" << endl;
+        return false;
+    }
+    writing = true;
+    fwrite(MAGIC, 1, sizeof(MAGIC), file);
+    put(VERSION, 2);
+    lastFrame = seconds();
+    return true;
+}
+
+bool Recorder::replay(string name) {
+    close();
+    file = fopen(name.c_str(), "rb");
+    if (!file) {
+        cerr << "**ERROR** Recorder::replay: Couldn't open " << name
+             << " for reading" << endl;
+        return false;
+    }
+    writing = false;
+    error = false;
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+            memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            !get(version, 2) || version != VERSION) {
+        cerr << "**ERROR** Recorder::replay: " << name
+             << " is not a recording this version can read" << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Recorder::put(uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        fputc((v >> 8*i) & 0xff, file);
+    }
+}
+
+void Recorder::putFloat(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    put(bits, 4);
+}
+
+bool Recorder::getFloat(float &f) {
+    uint32_t bits;
+    if (!get(bits, 4)) return false;
+    memcpy(&f, &bits, sizeof(f));
+    return true;
+}
+
+bool Recorder::get(uint32_t &v, int bytes) {
+    v = 0;
+    for (int i = 0; i < bytes; i++) {
+        int c = fgetc(file);
+        if (EOF == c) return false;
+        v |= uint32_t(c) << 8*i;
+    }
+    return true;
+}
+
+void Recorder::frame() {
+    if (!recording()) return;
+    double now = seconds();
+    put(FRAME, 1);
+    put(uint32_t((now - lastFrame) * 1e6), 4);
+    lastFrame = now;
+}
+
+void Recorder::control(int id, const vector<float> &values) {
+    if (!recording()) return;
+    put(CONTROL, 1);
+    put(uint32_t(id), 2);
+    put(values.size(), 1);
+    for (size_t i = 0; i < values.size(); i++) {
+        putFloat(values[i]);
+    }
+}
+
+void Recorder::key(unsigned char key) {
+    if (!recording()) return;
+    put(KEY, 1);
+    put(key, 1);
+}
+
+void Recorder::view(float zoom, float x, float y) {
+    if (!recording()) return;
+    put(VIEW, 1);
+    putFloat(zoom);
+    putFloat(x);
+    putFloat(y);
+}
+
+bool Recorder::next(Event &e) {
+    if (!file || writing || error) return false;
+    uint32_t kind, v;
+    if (!get(kind, 1)) {
+        //the end of the file between two events is the end of the recording
+        if (ferror(file)) {
+            cerr << "**ERROR** Recorder::next: Couldn't read the recording: "
+                 << strerror(errno) << endl;
+            error = true;
+        }
+        return false;
+    }
+    bool read = false;
+    e.kind = Kind(kind);
+    switch (kind) {
+    case FRAME:
+        read = get(v, 4);
+        e.micros = v;
+        break;
+    case CONTROL:
+        if (!get(v, 2)) break;
+        e.id = int16_t(v);
+        if (!get(v, 1)) break;
+        e.values.resize(v);
+        read = true;
+        for (size_t i = 0; read && i < e.values.size(); i++) {
+            read = getFloat(e.values[i]);
+        }
+        break;
+    case KEY:
+        read = get(v, 1);
+        e.key = v;
+        break;
+    case VIEW:
+        read = getFloat(e.zoom) && getFloat(e.center[0]) && getFloat(e.center[1]);
+        break;
+    default:
+        cerr << "**ERROR** Recorder::next: Unknown event " << kind << endl;
+        error = true;
+        return false;
+    }
+    if (!read) {
+        cerr << "**ERROR** Recorder::next: The recording ends in the middle of an event" << endl;
+        error = true;
+    }
+    return read;
+}
+
+void Recorder::close() {
+    if (file) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+bool checkRecorder(string file, ostream &out) {
+    Recorder rec;
+    if (!rec.record(file)) return false;
+    vector<float> values(3, 0.5f);
+    rec.frame();
+    rec.control(7, values);
+    rec.key('p');
+    rec.view(2, -0.25f, 0.75f);
+    rec.frame();
+    rec.close();
+
+    //the whole recording, kept to cut short below
+    vector<char> bytes;
+    FILE *f = fopen(file.c_str(), "rb");
+    if (f) {
+        for (int c; (c = fgetc(f)) != EOF;) bytes.push_back(char(c));
+        fclose(f);
+    }
+
+    //after the header, events end at these offsets
+    const size_t header = sizeof(MAGIC) + 2;
+    const size_t ends[] = { header, header + 5, header + 5 + 16, header + 5 + 16 + 2,
+            header + 5 + 16 + 2 + 13, header + 5 + 16 + 2 + 13 + 5 };
+    const size_t events = sizeof(ends) / sizeof(ends[0]) - 1;
+    bool ok = bytes.size() == ends[events];
+    if (!ok) {
+        out << "recording is " << bytes.size() << " bytes, expected " << ends[events] << endl;
+    }
+
+    //each copy must give the events that fit in it, and fail if it cuts one
+    //in two
+    int bad = 0, tried = 0;
+    for (size_t n = header; ok && n <= bytes.size(); n++, tried++) {
+        f = fopen(file.c_str(), "wb");
+        if (!f || fwrite(bytes.data(), 1, n, f) != n) {
+            out << "couldn't write " << file << endl;
+            if (f) fclose(f);
+            return false;
+        }
+        fclose(f);
+
+        size_t whole = 0;
+        while (whole < events && ends[whole + 1] <= n) ++whole;
+        bool cut = n != ends[whole];
+
+        Recorder in;
+        Recorder::Event e;
+        size_t read = 0;
+        if (in.replay(file)) {
+            while (in.next(e)) ++read;
+        }
+        if (read != whole || in.failed() != cut) {
+            out << n << " of " << bytes.size() << " bytes: read " << read << " events"
+                << (in.failed() ? " and failed" : "") << ", expected " << whole
+                << (cut ? " and a failure" : "") << endl;
+            ++bad;
+        }
+    }
+
+    //the last copy was the whole recording, check what it holds
+    Recorder in;
+    Recorder::Event e[events];
+    ok = ok && in.replay(file);
+    for (size_t i = 0; ok && i < events; i++) {
+        ok = in.next(e[i]);
+    }
+    ok = ok && Recorder::FRAME == e[0].kind
+            && Recorder::CONTROL == e[1].kind && 7 == e[1].id && values == e[1].values
+            && Recorder::KEY == e[2].kind && 'p' == e[2].key
+            && Recorder::VIEW == e[3].kind && 2 == e[3].zoom
+            && -0.25f == e[3].center[0] && 0.75f == e[3].center[1]
+            && Recorder::FRAME == e[4].kind;
+    in.close();
+    remove(file.c_str());
+
+    out << "recorder: " << tried << " lengths of a " << bytes.size() << " byte recording, "
+        << bad << " read wrongly, events " << (ok ? "match" : "DIFFER") << endl;
+    return ok && 0 == bad;
+}
+
+uint64_t fnv1a(const void *data, size_t size) {
+    const unsigned char *p = (const unsigned char *)data;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
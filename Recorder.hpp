@@ -0,0 +1,109 @@
+/*
+ * File: Recorder.hpp
+ * Description: Records user input to a file and plays it back.
+ */
+
+#ifndef RECORDER_HPP_
+#define RECORDER_HPP_
+
+#include <cstdio>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * Writes the events of a session to a compact binary file, or reads them
+ * back. A recording is a sequence of
+ *  - frames, with the time since the frame before,
+ *  - control changes, with the id passed to the GLUI callback and the values
+ *    of the controls after the change,
+ *  - key presses,
+ *  - zooms and pans of the view, with the zoom and the centre after them.
+ * Events are written as they happen, so the frame an event belongs to is the
+ * next frame after it. Numbers are stored little endian.
+ */
+class Recorder {
+public:
+    enum Kind { FRAME, CONTROL, KEY, VIEW };
+
+    struct Event {
+        Kind kind;
+        uint32_t micros; //FRAME: microseconds since the frame before
+        int id; //CONTROL: id of the control
+        std::vector<float> values; //CONTROL: values of the controls
+        unsigned char key; //KEY: the key pressed
+        float zoom; //VIEW: magnification of the view
+        float center[2]; //VIEW: point in the middle of the view
+    };
+
+    Recorder();
+    ~Recorder();
+
+    /**
+     * Creates the file and starts recording to it.
+     *
+     * @return false if the file could not be opened
+     */
+    bool record(std::string file);
+
+    /**
+     * Opens a recording to read its events with next().
+     *
+     * @return false if the file could not be opened or is not a recording
+     */
+    bool replay(std::string file);
+
+    bool recording() const { return file && writing; }
+
+    ///
+    ///Write an event. Nothing is written unless recording.
+    ///
+    void frame();
+    void control(int id, const std::vector<float> &values);
+    void key(unsigned char key);
+    void view(float zoom, float x, float y);
+
+    /**
+     * Reads the next event of a recording.
+     *
+     * @return false at the end of the recording, or if the rest of it could
+     *         not be read, which failed() tells apart
+     */
+    bool next(Event &e);
+
+    ///
+    ///True if reading stopped at a damaged or unreadable event rather than
+    ///the end of the recording.
+    ///
+    bool failed() const { return error; }
+
+    void close();
+
+private:
+    void put(uint32_t v, int bytes);
+    void putFloat(float f);
+    bool get(uint32_t &v, int bytes);
+    bool getFloat(float &f);
+
+    FILE *file;
+    bool writing;
+    bool error; //reading stopped at a bad event
+    double lastFrame; //time of the last frame recorded
+};
+
+/**
+ * Records events of every kind to file, then checks that the recording reads
+ * back the same and that every shorter copy of it either ends cleanly
+ * between two events or fails. Reports what it finds to out.
+ *
+ * @return false if any check failed
+ */
+bool checkRecorder(std::string file, std::ostream &out);
+
+/**
+ * 64 bit FNV-1a hash of size bytes.
+ */
+uint64_t fnv1a(const void *data, size_t size);
+
+#endif /* RECORDER_HPP_ */
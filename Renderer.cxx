@@ -0,0 +1,446 @@
+/*
+ * File: Renderer.cxx
+ * Description: Shader programs and GL state shared by the spirograph
+ *   programs.
+ */
+
+#include "Renderer.hpp"
+
+#include <GL/freeglut.h>
+
+#include <glm/gtc/matrix_access.hpp>
+
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <fstream>
+#include <vector>
+using namespace std;
+
+static const GLuint UNKNOWN = GLuint(-1); //cached value not known
+const int GpuTimer::LATENCY;
+
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+void TransformBlock::setModelView(const glm::mat4 &modelView) {
+    M = modelView;
+
+    //grab the normal matrix from the modelview matrix (upper 3x3 entries of
+    //modelview).
+    glm::mat3 normalMatrix(modelView);
+    normalMatrix = glm::inverse(normalMatrix);
+    normalMatrix = glm::transpose(normalMatrix);
+    for (int i = 0; i < 3; i++) {
+        M_n[i] = glm::vec4(normalMatrix[i], 0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//struct Frustum
+
+Frustum::Frustum(const glm::mat4 &mvp, float marginX, float marginY) {
+    //a point is in view where -w <= x, y, z <= w in clip coordinates, and
+    //each row of the matrix gives one of them from the point (Gribb and
+    //Hartmann, "Fast extraction of viewing frustum planes", 2001)
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) {
+        row[i] = glm::vec4(mvp[0][i], mvp[1][i], mvp[2][i], mvp[3][i]);
+    }
+    planes[0] = (1 + marginX) * row[3] + row[0];
+    planes[1] = (1 + marginX) * row[3] - row[0];
+    planes[2] = (1 + marginY) * row[3] + row[1];
+    planes[3] = (1 + marginY) * row[3] - row[1];
+    planes[4] = row[3] + row[2];
+    planes[5] = row[3] - row[2];
+}
+
+bool Frustum::intersects(const float lo[3], const float hi[3]) const {
+    for (int i = 0; i < 6; i++) {
+        //the corner of the box furthest inside the plane
+        const glm::vec4 &p = planes[i];
+        float d = p.w;
+        d += p.x * (p.x > 0 ? hi[0] : lo[0]);
+        d += p.y * (p.y > 0 ? hi[1] : lo[1]);
+        d += p.z * (p.z > 0 ? hi[2] : lo[2]);
+        if (d < 0) return false;
+    }
+    return true;
+}
+
+bool Frustum::contains(const float lo[3], const float hi[3]) const {
+    for (int i = 0; i < 6; i++) {
+        //the corner of the box furthest outside the plane
+        const glm::vec4 &p = planes[i];
+        float d = p.w;
+        d += p.x * (p.x > 0 ? lo[0] : hi[0]);
+        d += p.y * (p.y > 0 ? lo[1] : hi[1]);
+        d += p.z * (p.z > 0 ? lo[2] : hi[2]);
+        if (d < 0) return false;
+    }
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//class Shader
+
+Shader::Shader(string vertFile, string fragFile) {
+    fromFiles(vertFile, fragFile);
+}
+
+Shader::Shader(string vertFile, string geomFile, string fragFile) {
+    fromFiles(vertFile, fragFile, geomFile);
+}
+
+void Shader::fromFiles(string vertFile, string fragFile, string geomFile) {
+    //These are shader objects containing the shader source code
+    GLint vSource = setShaderSource(vertFile, GL_VERTEX_SHADER);
+    GLint fSource = setShaderSource(fragFile, GL_FRAGMENT_SHADER);
+
+    //Create a new shader program
+    program = glCreateProgram();
+
+    //Compile the source code for each shader and attach it to the program.
+    glCompileShader(vSource);
+    printLog("vertex compile log: ", vSource);
+    glAttachShader(program, vSource);
+
+    glCompileShader(fSource);
+    printLog("fragment compile log: ", fSource);
+    glAttachShader(program, fSource);
+
+    //the geometry shader is optional
+    if (!geomFile.empty()) {
+        GLint gSource = setShaderSource(geomFile, GL_GEOMETRY_SHADER);
+        glCompileShader(gSource);
+        printLog("geometry compile log: ", gSource);
+        glAttachShader(program, gSource);
+    }
+
+    //fixed attribute locations, so vertex array objects work with any program
+    glBindAttribLocation(program, POS_ATTRIB, "pos");
+    glBindAttribLocation(program, NORM_ATTRIB, "norm");
+    glBindAttribLocation(program, COLOR_ATTRIB, "color");
+
+    //link all of the attached shader objects
+    glLinkProgram(program);
+    printLog("link log: ", program);
+
+    GLuint block = glGetUniformBlockIndex(program, "Transform");
+    if (GL_INVALID_INDEX != block) {
+        glUniformBlockBinding(program, block, TRANSFORM_BINDING);
+    }
+}
+
+GLint Shader::setShaderSource(string file, GLenum type) {
+    //read source code
+    ifstream fin(file.c_str());
+    if (fin.fail()) {
+        cerr << "Could not open " << file << " for reading" << endl;
+        return -1;
+    }
+    fin.seekg(0, ios::end);
+    int count  = fin.tellg();
+    char *data = NULL;
+    if (count > 0) {
+        fin.seekg(ios::beg);
+        data = new char[count+1];
+        fin.read(data,count);
+        data[count] = '\0';
+    }
+    fin.close();
+
+    //create the shader
+    GLint s = glCreateShader(type);
+    glShaderSource(s, 1, const_cast<const char **>(&data), NULL);
+    delete [] data;
+    return s;
+}
+
+void Shader::printLog(string label, GLint obj) {
+    int infologLength = 0;
+    int maxLength;
+
+    if(glIsShader(obj)) {
+        glGetShaderiv(obj,GL_INFO_LOG_LENGTH,&maxLength);
+    } else {
+        glGetProgramiv(obj,GL_INFO_LOG_LENGTH,&maxLength);
+    }
+
+    vector<char> infoLog(maxLength + 1);
+
+    if (glIsShader(obj)) {
+        glGetShaderInfoLog(obj, maxLength, &infologLength, infoLog.data());
+    } else {
+        glGetProgramInfoLog(obj, maxLength, &infologLength, infoLog.data());
+    }
+
+    if (infologLength > 0) {
+        cerr << label << infoLog.data() << endl;
+    }
+}
+
+GLint Shader::uniformLoc(const char *name) const {
+    return glGetUniformLocation(program, name);
+}
+
+//
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+//class GLState
+
+GLState::GLState() {
+    invalidate();
+}
+
+void GLState::invalidate() {
+    program = vao = framebuffer = UNKNOWN;
+    vp[0] = vp[1] = vp[2] = vp[3] = -1;
+    buffers.clear();
+    caps.clear();
+    uniforms.clear();
+}
+
+void GLState::useProgram(GLuint program) {
+    if (changed(this->program == program)) {
+        glUseProgram(program);
+        this->program = program;
+    }
+}
+
+void GLState::bindVertexArray(GLuint vao) {
+    if (changed(this->vao == vao)) {
+        glBindVertexArray(vao);
+        this->vao = vao;
+        //the element buffer binding belongs to the vertex array object
+        buffers.erase(GL_ELEMENT_ARRAY_BUFFER);
+    }
+}
+
+void GLState::bindBuffer(GLenum target, GLuint buffer) {
+    map<GLenum, GLuint>::iterator it = buffers.find(target);
+    if (changed(it != buffers.end() && it->second == buffer)) {
+        glBindBuffer(target, buffer);
+        buffers[target] = buffer;
+    }
+}
+
+void GLState::bindFramebuffer(GLuint fbo) {
+    if (changed(framebuffer == fbo)) {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        framebuffer = fbo;
+    }
+}
+
+void GLState::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if (changed(vp[0] == x && vp[1] == y && vp[2] == width && vp[3] == height)) {
+        glViewport(x, y, width, height);
+        vp[0] = x; vp[1] = y; vp[2] = width; vp[3] = height;
+    }
+}
+
+void GLState::setEnabled(GLenum cap, bool enabled) {
+    map<GLenum, bool>::iterator it = caps.find(cap);
+    if (changed(it != caps.end() && it->second == enabled)) {
+        if (enabled) {
+            glEnable(cap);
+        } else {
+            glDisable(cap);
+        }
+        caps[cap] = enabled;
+    }
+}
+
+bool GLState::setUniform(GLint loc, float x, float y) {
+    if (loc < 0) return false; //not used by the program
+    pair<GLuint, GLint> key(program, loc);
+    map<pair<GLuint, GLint>, glm::vec2>::iterator it = uniforms.find(key);
+    if (!changed(it != uniforms.end() && it->second.x == x && it->second.y == y)) {
+        return false;
+    }
+    uniforms[key] = glm::vec2(x, y);
+    return true;
+}
+
+void GLState::uniform(GLint loc, float x) {
+    if (setUniform(loc, x, 0)) glUniform1f(loc, x);
+}
+
+void GLState::uniform(GLint loc, float x, float y) {
+    if (setUniform(loc, x, y)) glUniform2f(loc, x, y);
+}
+
+void GLState::uniform(GLint loc, int x) {
+    if (setUniform(loc, x, 0)) glUniform1i(loc, x);
+}
+
+void GLState::bufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    changed(false);
+    glBufferData(target, size, data, usage);
+    if (data) frame.bytesUploaded += size;
+}
+
+void GLState::bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data) {
+    changed(false);
+    glBufferSubData(target, offset, size, data);
+    frame.bytesUploaded += size;
+}
+
+void GLState::clear(GLbitfield mask) {
+    changed(false);
+    glClear(mask);
+}
+
+void GLState::blitFramebuffer(GLuint from, GLsizei width, GLsizei height) {
+    changed(false);
+    if (UNKNOWN == framebuffer) {
+        GLint bound;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &bound);
+        framebuffer = bound;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, from);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    //reading goes back to the framebuffer bindFramebuffer() bound
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+}
+
+void GLState::drawArrays(GLenum mode, GLint first, GLsizei count) {
+    changed(false);
+    ++frame.draws;
+    frame.vertices += count;
+    glDrawArrays(mode, first, count);
+}
+
+void GLState::drawElements(GLenum mode, GLsizei count, GLenum type, const void *offset) {
+    changed(false);
+    ++frame.draws;
+    frame.vertices += count;
+    glDrawElements(mode, count, type, offset);
+}
+
+void GLState::multiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count, GLsizei drawCount) {
+    changed(false);
+    ++frame.draws;
+    for (GLsizei i = 0; i < drawCount; i++) {
+        frame.vertices += count[i];
+    }
+    glMultiDrawArrays(mode, first, count, drawCount);
+}
+
+void GLState::endFrame() {
+    lastFrame = frame;
+    frame = Counters();
+}
+
+//
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+//class GpuTimer
+
+GpuTimer::GpuTimer() {
+    ms = totalMs = 0;
+    results = 0;
+    first = pending = 0;
+    created = available = timing = false;
+}
+
+void GpuTimer::begin() {
+    //the queries need a context, so they are made on first use
+    if (!created) {
+        created = true;
+        available = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+        if (available) glGenQueries(LATENCY, queries);
+    }
+
+    //if every query is still waiting for its result, this pass goes untimed
+    timing = available && pending < LATENCY;
+    if (timing) glBeginQuery(GL_TIME_ELAPSED, queries[(first + pending) % LATENCY]);
+}
+
+void GpuTimer::end() {
+    if (!timing) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    ++pending;
+    timing = false;
+}
+
+void GpuTimer::poll() {
+    //results arrive in the order the passes were issued
+    while (pending > 0) {
+        GLint ready = 0;
+        glGetQueryObjectiv(queries[first], GL_QUERY_RESULT_AVAILABLE, &ready);
+        if (!ready) break;
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(queries[first], GL_QUERY_RESULT, &ns);
+        ms = 1e-6 * ns;
+        totalMs += ms;
+        ++results;
+        first = (first + 1) % LATENCY;
+        --pending;
+    }
+}
+
+//
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+//class Hud
+
+Hud::Hud() : color(0, 0, 0) {
+    start = seconds();
+    frames = 0;
+    cpuTotal = 0;
+    vertexTotal = byteTotal = 0;
+    gpuStart = 0;
+    gpuResults = 0;
+}
+
+void Hud::frame(double cpuMs, const GpuTimer &gpu, const GLState::Counters &counters) {
+    ++frames;
+    cpuTotal += cpuMs;
+    vertexTotal += counters.vertices;
+    byteTotal += counters.bytesUploaded;
+    double now = seconds();
+    if (now - start < 0.5) return;
+
+    char line[64];
+    snprintf(line, sizeof(line), "%.1f fps", frames / (now - start));
+    text[0] = line;
+    snprintf(line, sizeof(line), "CPU %.2f ms", cpuTotal / frames);
+    text[1] = line;
+    if (gpu.results > gpuResults) {
+        snprintf(line, sizeof(line), "GPU %.2f ms", (gpu.totalMs - gpuStart) / (gpu.results - gpuResults));
+    } else {
+        snprintf(line, sizeof(line), "GPU %s", gpu.supported() ? "waiting" : "n/a");
+    }
+    text[2] = line;
+    snprintf(line, sizeof(line), "%lu vertices, %lu bytes uploaded",
+            (unsigned long)(vertexTotal / frames), (unsigned long)(byteTotal / frames));
+    text[3] = line;
+
+    start = now;
+    frames = 0;
+    cpuTotal = 0;
+    vertexTotal = byteTotal = 0;
+    gpuStart = gpu.totalMs;
+    gpuResults = gpu.results;
+}
+
+void Hud::draw(GLState &gl, int height) {
+    //bitmap text goes through the fixed function pipeline, and takes the
+    //color current when its position is set
+    gl.useProgram(0);
+    glColor3f(color.x, color.y, color.z);
+    for (int i = 0; i < 4; i++) {
+        glWindowPos2i(8, height - 20 - 16 * i);
+        glutBitmapString(GLUT_BITMAP_9_BY_15, (const unsigned char *)text[i].c_str());
+    }
+}
+
+//
+////////////////////////////////////////////////////////////////////////////////
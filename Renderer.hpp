@@ -0,0 +1,276 @@
+/*
+ * File: Renderer.hpp
+ * Description: Shader programs and GL state shared by the spirograph
+ *   programs.
+ */
+
+#ifndef RENDERER_HPP_
+#define RENDERER_HPP_
+
+#include <GL/glew.h> //must include this before gl.h
+#include <GL/gl.h>
+
+#include <glm/glm.hpp>
+
+#include <map>
+#include <string>
+#include <utility>
+
+///
+///Attribute locations every Shader binds its vertex inputs to, so a vertex
+///array object can be drawn with any of the programs.
+///
+enum { POS_ATTRIB = 0, NORM_ATTRIB = 1, COLOR_ATTRIB = 2 };
+
+///
+///Uniform buffer binding point of the Transform block.
+///
+const GLuint TRANSFORM_BINDING = 0;
+
+/**
+ * Host side copy of the Transform uniform block in the shaders, laid out by
+ * the std140 rules:
+ *
+ *   layout(std140) uniform Transform {
+ *       mat4 M; mat4 P; mat3 M_n; vec3 L_p; float time; vec3 E;
+ *   };
+ */
+struct TransformBlock {
+    glm::mat4 M; //modelview matrix
+    glm::mat4 P; //projection matrix
+    glm::vec4 M_n[3]; //normal matrix, std140 pads each column to a vec4
+    glm::vec3 L_p; //light position
+    float time; //time variable
+    glm::vec3 E; //view position
+    float pad;
+
+    /**
+     * Sets M and M_n from the modelview matrix.
+     */
+    void setModelView(const glm::mat4 &modelView);
+};
+
+/**
+ * The six clip planes of a view, for skipping geometry it cannot see.
+ */
+struct Frustum {
+    /**
+     * Takes the planes from a projection times modelview matrix. The sides
+     * are moved out by marginX and marginY in normalized device coordinates,
+     * so things drawn wider than their geometry, like wide lines, are kept.
+     */
+    Frustum(const glm::mat4 &mvp, float marginX = 0, float marginY = 0);
+
+    /**
+     * False if the box from lo to hi is entirely outside one of the planes.
+     * Boxes that only miss the view near a corner may still be kept.
+     */
+    bool intersects(const float lo[3], const float hi[3]) const;
+
+    /**
+     * True if the box from lo to hi is entirely inside every plane.
+     */
+    bool contains(const float lo[3], const float hi[3]) const;
+
+    glm::vec4 planes[6]; //inside where dot(plane, (x, y, z, 1)) >= 0
+};
+
+/**
+ * Simple class for keeping track of a shader program.
+ */
+class Shader {
+public:
+    Shader(std::string vertFile, std::string fragFile);
+    Shader(std::string vertFile, std::string geomFile, std::string fragFile);
+
+    /**
+     * Creates a shader program based on vertex, geometry and fragment
+     * source. The vertex inputs pos, norm and color are bound to POS_ATTRIB,
+     * NORM_ATTRIB and COLOR_ATTRIB and the Transform block to
+     * TRANSFORM_BINDING.
+     *
+     * @param vertFile Path to vertex source
+     * @param fragFile Path to fragment source
+     * @param geomFile Path to geometry source, or empty for none
+     */
+    void fromFiles(std::string vertFile, std::string fragFile, std::string geomFile = "");
+
+    /**
+     * Helper method for reading in the source for a shader and creating a
+     * shader object.
+     *
+     * @param file Filename of shader source
+     * @param type Type of shader-> GL_VERTEX_SHADER, GL_GEOMETRY_SHADER or
+     *   GL_FRAGMENT_SHADER
+     */
+    GLint setShaderSource(std::string file, GLenum type);
+
+    /**
+     * Helper function used for debugging.
+     */
+    void printLog(std::string label, GLint obj);
+
+    /**
+     * Location of a uniform outside the Transform block.
+     */
+    GLint uniformLoc(const char *name) const;
+
+    GLuint program; //shader program
+};
+
+/**
+ * Mirrors the GL state the programs touch so calls that would not change
+ * anything are skipped. Every GL call made during a frame should go through
+ * here; after calling GL directly, call invalidate().
+ *
+ * Counts the calls requested and actually issued in each frame.
+ */
+class GLState {
+public:
+    struct Counters {
+        Counters() : requested(0), issued(0), draws(0), vertices(0), bytesUploaded(0) {}
+
+        unsigned requested; //calls asked for
+        unsigned issued; //calls that reached GL
+        unsigned draws; //draw calls
+        size_t vertices; //vertices (or indices) drawn
+        size_t bytesUploaded; //buffer data sent to GL
+    };
+
+    GLState();
+
+    /**
+     * Forgets everything cached, so the next call of each kind is issued.
+     */
+    void invalidate();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void bindBuffer(GLenum target, GLuint buffer);
+    void bindFramebuffer(GLuint fbo);
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void setEnabled(GLenum cap, bool enabled);
+
+    ///
+    ///Sets a uniform of the current program.
+    ///
+    void uniform(GLint loc, float x);
+    void uniform(GLint loc, float x, float y);
+    void uniform(GLint loc, int x);
+
+    ///
+    ///Buffer uploads to the buffer bound to target. Always issued.
+    ///
+    void bufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+    void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
+
+    ///
+    ///Passed straight through, only counted.
+    ///
+    void clear(GLbitfield mask);
+    void drawArrays(GLenum mode, GLint first, GLsizei count);
+    void drawElements(GLenum mode, GLsizei count, GLenum type, const void *offset);
+    void multiDrawArrays(GLenum mode, const GLint *first, const GLsizei *count, GLsizei drawCount);
+
+    /**
+     * Copies the color of the bottom left width x height pixels of
+     * framebuffer from to the same pixels of the bound one.
+     */
+    void blitFramebuffer(GLuint from, GLsizei width, GLsizei height);
+
+    /**
+     * Moves the counters of the current frame to lastFrame.
+     */
+    void endFrame();
+
+    Counters frame, lastFrame;
+
+private:
+    bool changed(bool same) {
+        ++frame.requested;
+        if (same) return false;
+        ++frame.issued;
+        return true;
+    }
+    bool setUniform(GLint loc, float x, float y);
+
+    GLuint program, vao, framebuffer;
+    GLint vp[4];
+    std::map<GLenum, GLuint> buffers;
+    std::map<GLenum, bool> caps;
+    std::map<std::pair<GLuint, GLint>, glm::vec2> uniforms;
+};
+
+/**
+ * Measures how long the GPU spends on a pass of each frame with timer
+ * queries. GL only returns the time once the GPU has finished the pass, a
+ * frame or more later, so results are collected by poll() when they are
+ * there and never waited for. Up to LATENCY passes can be in flight; if
+ * the GPU falls further behind, passes go untimed until it catches up.
+ *
+ * Does nothing where timer queries are not supported (before GL 3.3).
+ */
+class GpuTimer {
+public:
+    static const int LATENCY = 4; //passes that can be waiting for a result
+
+    GpuTimer();
+
+    ///
+    ///Start and stop timing a pass. Passes cannot overlap.
+    ///
+    void begin();
+    void end();
+
+    /**
+     * Collects the results that have arrived, without waiting for the rest.
+     * Call once a frame.
+     */
+    void poll();
+
+    bool supported() const { return available; }
+
+    double ms; //GPU time of the latest pass with a result
+    double totalMs; //GPU time of every pass with a result
+    unsigned results; //passes with a result
+
+private:
+    GLuint queries[LATENCY]; //ring of queries, oldest in flight at first
+    int first, pending; //oldest query in flight and how many are
+    bool created, available, timing;
+};
+
+/**
+ * Text drawn over the picture with the frame rate and the CPU time, GPU
+ * time, vertices drawn and bytes uploaded per frame, averaged over about
+ * half a second.
+ */
+class Hud {
+public:
+    Hud();
+
+    /**
+     * Adds a frame that took cpuMs to issue, with the counters GLState kept
+     * for it. gpu is the timer of the frame's passes.
+     */
+    void frame(double cpuMs, const GpuTimer &gpu, const GLState::Counters &counters);
+
+    /**
+     * Draws the text in the top left corner of a viewport height pixels high
+     * with a GLUT bitmap font. Leaves no program in use.
+     */
+    void draw(GLState &gl, int height);
+
+    glm::vec3 color; //color of the text
+
+private:
+    double start; //when the current half second started
+    unsigned frames; //frames so far in it
+    double cpuTotal; //their CPU time
+    size_t vertexTotal, byteTotal; //their vertices and uploads
+    double gpuStart; //totalMs of the timer when it started
+    unsigned gpuResults; //results of the timer when it started
+    std::string text[4]; //lines shown, from the last half second
+};
+
+#endif /* RENDERER_HPP_ */
@@ -0,0 +1,289 @@
+/*
+ * File: TubeMesh.cxx
+ * Description: Indexed triangle mesh of a tube swept along a curve.
+ */
+
+#include "TubeMesh.hpp"
+#include "Curve.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <deque>
+#include <thread>
+using namespace std;
+
+static const size_t MIN_CHUNK = 4096; //fewest rings worth giving a thread
+
+static glm::vec3 point(const float *path, size_t i) {
+    return glm::vec3(path[3*i], path[3*i+1], path[3*i+2]);
+}
+
+//some unit vector perpendicular to the unit vector t
+static glm::vec3 perpendicular(const glm::vec3 &t) {
+    glm::vec3 axis(0, 0, 1);
+    if (fabs(t.x) <= fabs(t.y) && fabs(t.x) <= fabs(t.z)) {
+        axis = glm::vec3(1, 0, 0);
+    } else if (fabs(t.y) <= fabs(t.z)) {
+        axis = glm::vec3(0, 1, 0);
+    }
+    return glm::normalize(glm::cross(t, axis));
+}
+
+//Moves normal n from the frame at point a with tangent ta to point b with
+//tangent tb by the double reflection method (Wang et al., "Computation of
+//rotation minimizing frames", 2008).
+static glm::vec3 transport(const glm::vec3 &n, const glm::vec3 &a, const glm::vec3 &b,
+        const glm::vec3 &ta, const glm::vec3 &tb) {
+    glm::vec3 v1 = b - a;
+    float c1 = glm::dot(v1, v1);
+    glm::vec3 nL = n, tL = ta;
+    if (c1 > 0) {
+        nL = n - (2 / c1) * glm::dot(v1, n) * v1;
+        tL = ta - (2 / c1) * glm::dot(v1, ta) * v1;
+    }
+    glm::vec3 v2 = tb - tL;
+    float c2 = glm::dot(v2, v2);
+    if (c2 > 0) {
+        nL = nL - (2 / c2) * glm::dot(v2, nL) * v2;
+    }
+    return nL;
+}
+
+//rotates n, which is perpendicular to the unit vector t, by angle about t
+static glm::vec3 rotate(const glm::vec3 &n, float angle, const glm::vec3 &t) {
+    return float(cos(angle)) * n + float(sin(angle)) * glm::cross(t, n);
+}
+
+TubeMesh::TubeMesh(int sides, float radius) : sides(sides), radius(radius) {
+    clear();
+}
+
+void TubeMesh::clear() {
+    verts.clear();
+    norms.clear();
+    colors.clear();
+    indices.clear();
+    ringCount = 0;
+}
+
+void TubeMesh::update(const vector<float> &path, unsigned threads) {
+    //a point gets its ring once the point after it is known
+    size_t first = ringCount, last = path.size() / 3;
+    last = last > 0 ? last - 1 : 0;
+    if (first >= last) return;
+    size_t n = last - first;
+    const float *p = path.data();
+
+    //small batches, such as a point per frame, are not worth a thread
+    size_t chunks = max(size_t(1), n / MIN_CHUNK);
+    if (chunks > 1) {
+        if (0 == threads) threads = max(1u, thread::hardware_concurrency());
+        chunks = min(chunks, size_t(threads));
+    }
+    chunkStart.resize(chunks + 1);
+    chunkAngle.resize(chunks);
+    for (size_t c = 0; c <= chunks; c++) {
+        chunkStart[c] = first + n * c / chunks;
+    }
+
+    //tangents and frames of each chunk, from an arbitrary starting normal
+    tangents.resize(n);
+    normals.resize(n);
+    vector<thread> workers;
+    for (size_t c = 1; c < chunks; c++) {
+        workers.push_back(thread(&TubeMesh::transportChunk, this, p, chunkStart[c], chunkStart[c+1]));
+    }
+    transportChunk(p, chunkStart[0], chunkStart[1]);
+    for (size_t c = 0; c < workers.size(); c++) workers[c].join();
+    workers.clear();
+
+    //Transport is linear in the starting normal, so a chunk started from the
+    //wrong normal only needs turning about the tangent by a fixed angle. Find
+    //the angle that continues the frame of the chunk before.
+    for (size_t c = 0; c < chunks; c++) {
+        size_t s = chunkStart[c] - first;
+        glm::vec3 incoming;
+        if (c > 0) {
+            size_t e = s - 1;
+            glm::vec3 end = rotate(normals[e], chunkAngle[c-1], tangents[e]);
+            incoming = transport(end, point(p, first + e), point(p, first + s),
+                    tangents[e], tangents[s]);
+        } else if (first > 0) {
+            incoming = transport(lastNormal, point(p, first - 1), point(p, first),
+                    lastTangent, tangents[0]);
+        } else {
+            chunkAngle[c] = 0;
+            continue;
+        }
+        chunkAngle[c] = atan2(glm::dot(tangents[s], glm::cross(normals[s], incoming)),
+                glm::dot(normals[s], incoming));
+    }
+    lastTangent = tangents[n-1];
+    lastNormal = rotate(normals[n-1], chunkAngle[chunks-1], lastTangent);
+
+    //write the rings and the bands joining them
+    ringCount = last;
+    verts.resize(3 * sides * ringCount);
+    norms.resize(3 * sides * ringCount);
+    colors.resize(4 * sides * ringCount);
+    indices.resize(6 * sides * (ringCount - 1));
+    for (size_t c = 1; c < chunks; c++) {
+        workers.push_back(thread(&TubeMesh::emitChunk, this, p, chunkStart[c], chunkStart[c+1], c));
+    }
+    emitChunk(p, chunkStart[0], chunkStart[1], 0);
+    for (size_t c = 0; c < workers.size(); c++) workers[c].join();
+}
+
+void TubeMesh::transportChunk(const float *path, size_t begin, size_t end) {
+    size_t first = chunkStart[0];
+
+    for (size_t i = begin; i < end; i++) {
+        //central difference, falling back to one side at the start or where
+        //points repeat
+        glm::vec3 d = point(path, i+1) - point(path, i > 0 ? i-1 : i);
+        if (glm::dot(d, d) == 0) d = point(path, i+1) - point(path, i);
+        if (glm::dot(d, d) == 0) d = glm::vec3(1, 0, 0);
+        tangents[i - first] = glm::normalize(d);
+    }
+
+    normals[begin - first] = perpendicular(tangents[begin - first]);
+    for (size_t i = begin + 1; i < end; i++) {
+        glm::vec3 n = transport(normals[i-1 - first], point(path, i-1), point(path, i),
+                tangents[i-1 - first], tangents[i - first]);
+        normals[i - first] = glm::normalize(n);
+    }
+}
+
+void TubeMesh::emitChunk(const float *path, size_t begin, size_t end, size_t chunk) {
+    size_t first = chunkStart[0];
+    float angle = chunkAngle[chunk];
+
+    for (size_t i = begin; i < end; i++) {
+        glm::vec3 t = tangents[i - first];
+        glm::vec3 n = rotate(normals[i - first], angle, t);
+        glm::vec3 b = glm::cross(t, n);
+        glm::vec3 c = point(path, i);
+
+        //color cycles slowly along the tube
+        float hue = 2 * M_PI * fmod(i * 0.0005, 1.0);
+        uint8_t rgb[3];
+        for (int k = 0; k < 3; k++) {
+            rgb[k] = uint8_t(127.5f + 127.5f * cos(hue - k * 2 * M_PI / 3));
+        }
+
+        for (int s = 0; s < sides; s++) {
+            float a = 2 * M_PI * s / sides;
+            glm::vec3 dir = float(cos(a)) * n + float(sin(a)) * b;
+            glm::vec3 v = c + radius * dir;
+            size_t k = size_t(i) * sides + s;
+            verts[3*k] = v.x; verts[3*k+1] = v.y; verts[3*k+2] = v.z;
+            norms[3*k] = dir.x; norms[3*k+1] = dir.y; norms[3*k+2] = dir.z;
+            colors[4*k] = rgb[0]; colors[4*k+1] = rgb[1]; colors[4*k+2] = rgb[2];
+            colors[4*k+3] = 255;
+        }
+
+        //the band from the previous ring to this one, two triangles per side
+        if (0 == i) continue;
+        uint32_t *tri = &indices[6 * sides * (i-1)];
+        uint32_t a0 = (i-1) * sides, b0 = i * sides;
+        for (int s = 0; s < sides; s++) {
+            int s1 = (s + 1) % sides;
+            tri[0] = a0 + s; tri[1] = a0 + s1; tri[2] = b0 + s;
+            tri[3] = a0 + s1; tri[4] = b0 + s1; tri[5] = b0 + s;
+            tri += 6;
+        }
+    }
+}
+
+size_t TubeMesh::memory() const {
+    return verts.capacity() * sizeof(float) + norms.capacity() * sizeof(float) +
+            colors.capacity() + indices.capacity() * sizeof(uint32_t);
+}
+
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+//vertices transformed per triangle with a FIFO post-transform cache
+static double cacheMissRatio(const vector<uint32_t> &indices, size_t size) {
+    deque<uint32_t> cache;
+    size_t misses = 0;
+    for (size_t i = 0; i < indices.size(); i++) {
+        if (find(cache.begin(), cache.end(), indices[i]) != cache.end()) continue;
+        ++misses;
+        cache.push_back(indices[i]);
+        if (cache.size() > size) cache.pop_front();
+    }
+    return double(misses) / (indices.size() / 3);
+}
+
+void benchmarkTube(size_t count, ostream &out) {
+    //classic curve, rising as it goes
+    const double h = 0.001;
+    CurveGenerator *curve = makeGenerator(classicChain(0.0893, 1.854, 0.8), h);
+    vector<float> path(3 * count);
+    curve->generate(count, path.data());
+    for (size_t i = 0; i < count; i++) {
+        path[3*i+2] = 0.02 * i * h;
+    }
+    delete curve;
+
+    TubeMesh tube;
+    unsigned cores = max(1u, thread::hardware_concurrency());
+    double start = seconds();
+    tube.update(path, 1);
+    double serial = seconds() - start;
+
+    TubeMesh parallel;
+    start = seconds();
+    parallel.update(path, cores);
+    double threaded = seconds() - start;
+
+    //the chunks of the parallel build have to line up with the serial one
+    float maxDiff = 0;
+    for (size_t i = 0; i < tube.verts.size(); i++) {
+        maxDiff = max(maxDiff, float(fabs(tube.verts[i] - parallel.verts[i])));
+    }
+
+    //one point at a time
+    TubeMesh grown;
+    vector<float> partial;
+    partial.reserve(path.size());
+    double worst = 0, total = 0;
+    for (size_t i = 0; i < count; i++) {
+        partial.insert(partial.end(), &path[3*i], &path[3*i+3]);
+        start = seconds();
+        grown.update(partial);
+        double t = seconds() - start;
+        total += t;
+        worst = max(worst, t);
+    }
+
+    out << count << " point tube, " << tube.sides << " sides: "
+        << tube.triangles() << " triangles, " << tube.memory() / (1024*1024)
+        << " MB (" << double(tube.memory()) / tube.triangles() << " bytes/triangle)" << endl
+        << "  build, 1 thread:   " << 1e3 * serial << " ms ("
+        << 1e9 * serial / tube.triangles() << " ns/triangle)" << endl
+        << "  build, " << cores << " threads: " << 1e3 * threaded << " ms, max difference "
+        << maxDiff << endl
+        << "  growing by 1 point: " << 1e9 * total / count << " ns/point mean, "
+        << 1e6 * worst << " us worst" << endl;
+
+    //the same triangles listed one side of the tube at a time
+    vector<uint32_t> bySide;
+    bySide.reserve(tube.indices.size());
+    for (int s = 0; s < tube.sides; s++) {
+        for (size_t band = 0; band + 1 < tube.rings(); band++) {
+            const uint32_t *tri = &tube.indices[6 * (tube.sides * band + s)];
+            bySide.insert(bySide.end(), tri, tri + 6);
+        }
+    }
+    for (size_t size = 16; size <= 32; size *= 2) {
+        out << "  vertices per triangle, " << size << " entry cache: "
+            << cacheMissRatio(tube.indices, size) << " band order, "
+            << cacheMissRatio(bySide, size) << " side order" << endl;
+    }
+}
@@ -11,220 +11,203 @@
 #include <GL/gl.h>
 #include <GL/glui.h>
 
+#include "Curve.hpp"
+#include "CurveIndex.hpp"
+#include "CurvePreview.hpp"
+#include "CurveStore.hpp"
+#include "Exposure.hpp"
+#include "ImageWriter.hpp"
+#include "Recorder.hpp"
+#include "Renderer.hpp"
+
 #define GLM_SWIZZLE
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/matrix_access.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
 
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include <vector>
 #include <string>
-#include <fstream>
 using namespace std;
 
-/**
- * Simple class for keeping track of shader program and vertex attribute
- * locations.
- */
-class Shader {
-public:
-    Shader(string vertFile, string fragFile) { fromFiles(vertFile, fragFile); }
-
-    /**
-     * Creates a shader program based on vertex and fragment source.
-     *
-     * @param vertFile Path to vertex source
-     * @param fragFile Path to fragment source
-     */
-    void fromFiles(string vertFile, string fragFile) {
-        //These are shader objects containing the shader source code
-        GLint vSource = setShaderSource(vertFile, GL_VERTEX_SHADER);
-        GLint fSource = setShaderSource(fragFile, GL_FRAGMENT_SHADER);
-
-        //Create a new shader program
-        program = glCreateProgram();
-
-        //Compile the source code for each shader and attach it to the program.
-        glCompileShader(vSource);
-        printLog("vertex compile log: ", vSource);
-        glAttachShader(program, vSource);
-
-        glCompileShader(fSource);
-        printLog("fragment compile log: ", fSource);
-        glAttachShader(program, fSource);
-
-        //we could attach more shaders, such as a geometry or tessellation
-        //shader here.
-
-        //link all of the attached shader objects
-        glLinkProgram(program);
-    }
-
-    /**
-     * Helper method for reading in the source for a shader and creating a
-     * shader object.
-     *
-     * @param file Filename of shader source
-     * @param type Type of shader-> Only GL_VERTEX_SHADER and GL_FRAGMENT_SHADER
-     *   are supported here.
-     */
-    GLint setShaderSource(string file, GLenum type) {
-        //read source code
-        ifstream fin(file.c_str());
-        if (fin.fail()) {
-            cerr << "Could not open " << file << " for reading" << endl;
-            return -1;
-        }
-        fin.seekg(0, ios::end);
-        int count  = fin.tellg();
-        char *data = NULL;
-        if (count > 0) {
-            fin.seekg(ios::beg);
-            data = new char[count+1];
-            fin.read(data,count);
-            data[count] = '\0';
-        }
-        fin.close();
-
-        //create the shader
-        GLint s = glCreateShader(type);
-        glShaderSource(s, 1, const_cast<const char **>(&data), NULL);
-        delete [] data;
-        return s;
-    }
-
-    /**
-     * Helper function used for debugging.
-     */
-    void printLog(std::string label, GLint obj) {
-        int infologLength = 0;
-        int maxLength;
-
-        if(glIsShader(obj)) {
-            glGetShaderiv(obj,GL_INFO_LOG_LENGTH,&maxLength);
-        } else {
-            glGetProgramiv(obj,GL_INFO_LOG_LENGTH,&maxLength);
-        }
-
-        char infoLog[maxLength];
-
-        if (glIsShader(obj)) {
-            glGetShaderInfoLog(obj, maxLength, &infologLength, infoLog);
-        } else {
-            glGetProgramInfoLog(obj, maxLength, &infologLength, infoLog);
-        }
-
-        if (infologLength > 0) {
-            cerr << label << infoLog << endl;
-        }
-    }
-
-    GLint program; //shader program
-    GLint modelViewLoc; //location of the modelview matrix in the program (M)
-    GLint projectionLoc; //location of the projection matrix in the program (P)
-    GLint normalMatrixLoc; //location of the normal matrix in the program (M_n)
-    GLint vertexLoc, normalLoc; //vertex attribute locations (pos and norm)
-      //respectively
-    GLint timeLoc; //location of time variable
-    GLuint vertexBuffer, normalBuffer; //used to keep track of GL buffer objects
-};
 Shader *shader = NULL;
+Shader *wideShader = NULL; //draws the curve as wide lines
+GLint viewportLoc, lineWidthLoc, roundJoinLoc; //wide line uniform locations
+GLint trailSizeLoc[2], trailNewestLoc[2]; //trail fade uniform locations in shader and wideShader
+GLint previewLoc[2]; //preview color uniform locations in shader and wideShader
+GLState gl; //cached GL state, all drawing goes through here
+TransformBlock transforms; //contents of the Transform uniform buffer
+GLuint transformBuffer; //uniform buffer holding transform
+const size_t SLAB_CHUNKS = 16; //curve chunks in each GPU buffer
+vector<GLuint> slabBuffers, slabVAOs; //GPU buffers of the curve and their vertex arrays
+vector<GLint> drawFirst; //start of each chunk drawn by a multi-draw call
+vector<GLsizei> drawCount; //points of each chunk drawn by a multi-draw call
+size_t uploaded = 0; //points of the curve already on the GPU
+size_t drawnStrips, drawnPoints; //strips and points of the curve last drawn
+const size_t TRAIL_LEAD = CurveStore::OVERLAP; //slots before the trail's ring repeating its end
+GLuint trailBuffer = 0, trailVAO = 0; //GPU ring buffer of the trail and its vertex array
+size_t trailSlots = 0; //points the trail's ring has room for
+uint64_t trailCount = 0; //points added to the trail since it started
+vector<float> trailPoints; //points on their way to the trail's ring
+CurvePreview preview; //the whole curve at once while the animation draws it
+const size_t PREVIEW_PER_FRAME = 1 << 17; //points a frame spent refining or drawing the preview
+GLuint previewBuffer = 0, previewVAO = 0; //GPU buffer of the preview and its vertex array
+size_t previewPoints = 0; //points of the preview on the GPU
+size_t previewStride = 1; //points of the buffer each vertex of previewVAO steps over
+GLuint previewFBO[2] = { 0, 0 }, previewColor[2] = { 0, 0 }; //images of the preview
+int previewFront = 0; //the image copied under each frame, the other is drawn a bit a frame
+int previewWidth = 0, previewHeight = 0; //size of previewColor
+bool previewStale = true; //a finished level is not in the images yet
+bool previewShown = false; //the front image is of the current curve, view and lines
+glm::mat4 previewView; //projection times modelview the images are drawn with
+glm::vec3 previewLines; //wideLines, lineWidth and roundJoins they are drawn with
+vector<GLint> previewFirst; //strips of the level being drawn into the back image
+vector<GLsizei> previewCount;
+size_t previewStrip = 0, previewDrawn = 0; //next strip to draw and its points already drawn
+int showPreview = 1; //draw the preview under the curve if set
+int showStats = 0; //print GL call counts every second if set
+int showHud = 0; //draw frame timings over the curve if set
+GpuTimer gpuTimer; //times drawing the curve on the GPU
+Hud hud; //frame timings drawn over the curve
+Recorder recorder; //records input with --record
 
 int WIN_WIDTH = 720, WIN_HEIGHT = 720; //window width/height
 glm::mat4 modelView, projection, camera; //matrices for shaders
+float viewZoom = 1; //magnification of the view, 1 shows the whole curve
+glm::vec2 viewCenter(0, 0); //point of the curve's plane in the middle of the view
+bool dragging = false; //panning with the left mouse button
+int dragX, dragY; //last mouse position while panning
 float animTime = 0.0f, deltaT = 0.001; //variables for animation
-float r, R, p, S, t; //variables for spirograph
-vector<float> verts; //vertex array
-vector<float> norms; //normal array
-size_t numVerts; //number of total vertices
-int main_window; //id of main graphics window
-
-//updates values based on some change in time
-void update(float dt) {
-	animTime += dt; //increment the time
-
-	//generate the next point of the spirograph
-    t = animTime * S;
-    float x = (R+r)*cos(t) + p*cos(((R+r)*t)/r);
-    float y = (R+r)*sin(t) + p*sin(((R+r)*t)/r);
-    verts.push_back(x);
-    verts.push_back(y);
-    verts.push_back(0);
-    norms.push_back(0);norms.push_back(0);norms.push_back(1);
+float r, R, p, S; //variables for spirograph
+int usePhasor = 1; //generate points by phasor recurrence instead of cos/sin
+int wideLines = 0, roundJoins = 0; //variables for wide line drawing
+float lineWidth = 3; //width of wide lines in pixels
+int trailMode = 0; //keep only the newest trailSize points
+int trailSize = 100000; //points kept in trail mode
+int trailFade = 1; //fade the trail out with age
+int posterWidth = 16384, posterHeight = 16384; //size of saved posters
+char posterFile[256] = "poster.ppm"; //file posters are saved to
+int exposureWidth = 2048, exposureHeight = 2048; //size of saved exposures
+int exposureSamples = 100; //millions of samples in an exposure
+char exposureFile[256] = "exposure.ppm"; //file exposures are saved to
 
-    numVerts = verts.size() / 3;
+//An exposure being made in the background from the Save Exposure button,
+//with everything it reads, so the window keeps running meanwhile. It is
+//never freed while the worker runs, not even on exit.
+struct ExposureJob {
+    Chain chain;
+    double h;
+    uint64_t samples;
+    int width, height;
+    string file;
+    ostringstream out; //report of renderExposure
+    atomic<uint64_t> taken; //samples taken so far
+    atomic<bool> finished;
+    bool written; //result of renderExposure, once finished
+};
+ExposureJob *exposureJob = NULL; //NULL unless an exposure is being made
+thread *exposureWorker = NULL; //makes exposureJob
+GLUI_StaticText *exposure_status; //shows how far the exposure has got
+int wheels = 4, symmetry = 5; //variables for the nested wheel preset
+int preset = 0; //kind of curve the chain is built from
+Chain chain; //rotating terms of the curve
+CurveGenerator *curve = NULL; //generates the points of the curve
+int termIdx = 0; //term shown in the term editor
+float termAmp, termPhase, termFreq, termDamp; //editable copy of that term
+CurveStore curveStore; //points of the curve
+CurveIndex curveIndex(curveStore); //finds the segment under the mouse
+const int PICK_PIXELS = 8; //how close the mouse has to be to the curve
+int main_window; //id of main graphics window
+GLUI *glui; //id of GLUI window
+GLUI_Spinner *term_spinner; //selects termIdx
+GLUI_StaticText *pick_text; //shows the point under the mouse
+char pickText[128]; //text of pick_text
 
-    //manage the camera (and make sure it contains the spirograph)
-    camera = glm::lookAt(glm::vec3(0,0,4 * (r + R + p)), glm::vec3(0,0,0), glm::vec3(0,1,0));
+//ids for the GLUI controls
+enum {
+    RADIUS1_ID, RADIUS2_ID, PEN_ID, STEP_ID, PHASOR_ID,
+    PRESET_ID, WHEELS_ID, TERM_ID, TERM_EDIT_ID, ADD_TERM_ID, REMOVE_TERM_ID,
+    LINES_ID, POSTER_ID, TRAIL_ID, FADE_ID, EXPOSURE_ID
+};
 
-        projection = glm::perspective(
-                glm::float_t(45),
-                glm::float_t(WIN_WIDTH) / glm::float_t(WIN_HEIGHT),
-                glm::float_t(0.1),
-                glm::float_t(1000.0)
-        );
+//kinds of curves in the preset listbox
+enum { CLASSIC, HYPOTROCHOID, EPITROCHOID, NESTED_WHEELS, HARMONOGRAPH, CUSTOM };
 
-    //update the vertex and normal buffers
-    glBindBuffer(GL_ARRAY_BUFFER, shader->vertexBuffer);
-        glBufferData( GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_DYNAMIC_DRAW );
+//projection for a view of the given size. Zooming narrows the field of
+//view rather than moving the camera, so the near plane never cuts the curve.
+glm::mat4 viewProjection(int width, int height) {
+    float fovy = 2 * atan(tan(22.5 * M_PI / 180) / viewZoom) * 180 / M_PI;
+    return glm::perspective(
+            glm::float_t(fovy), //45 when not zoomed
+            glm::float_t(width) / glm::float_t(height),
+            glm::float_t(0.1),
+            glm::float_t(1000.0)
+    );
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, shader->normalBuffer);
-    glBufferData(GL_ARRAY_BUFFER, norms.size() * sizeof(float), norms.data(), GL_DYNAMIC_DRAW );
+//manage the camera (and make sure it contains the spirograph)
+void updateCamera() {
+    float distance = 4 * chainExtent(chain);
+    camera = glm::lookAt(glm::vec3(viewCenter, distance), glm::vec3(viewCenter, 0), glm::vec3(0,1,0));
+    projection = viewProjection(WIN_WIDTH, WIN_HEIGHT);
+}
 
+//size of a pixel of the window in the curve's plane, in the middle of the
+//view where the camera looks straight at it
+float pixelSize() {
+    float distance = 4 * chainExtent(chain);
+    return 2 * distance * tan(22.5 * M_PI / 180) / viewZoom / WIN_HEIGHT;
 }
 
-//reshape function for GLUT
-void reshape(int w, int h) {
-    WIN_WIDTH = w;
-    WIN_HEIGHT = h;
-    projection = glm::perspective(
-            glm::float_t(45), //45
-            glm::float_t(WIN_WIDTH) / glm::float_t(WIN_HEIGHT),
-            glm::float_t(0.1),
-            glm::float_t(1000.0)
-    );
+//The preview is only worth drawing until the animation has drawn all of it,
+//which a trail never does as it drops its oldest points. Its span is only
+//known once it has points.
+bool previewWanted() {
+    if (!showPreview) return false;
+    return trailMode || 0 == preview.size() || curve->step() * fabs(curve->stepSize()) < preview.span();
 }
 
-//display function for GLUT
-void display() {
-    glViewport(0,0,WIN_WIDTH,WIN_HEIGHT);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    //Setup the modelview matrix
-    glm::mat4 modelCam = camera * modelView;
-
-    //grab the normal matrix from the modelview matrix (upper 3x3 entries of
-    //modelview).
-    glm::mat3 normalMatrix(modelCam);
-    normalMatrix = glm::inverse(normalMatrix);
-    normalMatrix = glm::transpose(normalMatrix);
-
-    //Tell OpenGL which shader program we want to use. In this case, we are only
-    //using one, but in general we might have many shader programs.
-    glUseProgram(shader->program);
-
-    //Pass the matrices and animation time to GPU
-    glUniformMatrix4fv(
-            shader->modelViewLoc, //handle to variable in the shader program
-            1, //how many matrices we want to send
-            GL_FALSE, //transpose the matrix
-            glm::value_ptr(modelCam) //a pointer to an array containing the entries for
-              //the matrix
+//adds a GPU buffer with room for SLAB_CHUNKS chunks of the curve
+void addSlab() {
+    GLuint buffer, vao;
+    glGenBuffers(1, &buffer);
+
+    //The vertex array object records which buffer feeds each attribute, so
+    //drawing only has to bind it again.
+    glGenVertexArrays(1, &vao);
+    gl.bindVertexArray(vao);
+
+    //This is where we make room for the vertex data on the GPU.
+    //In genereal, the procedure for working with buffers is:
+    //  1. Tell OpenGL which buffer we're using (glBindBuffer)
+    //  2. Tell OpenGL what to do with the buffer (e.g. fill buffer, use the
+    //     in the buffer, etc).
+    //
+    //Here we only size the buffer (glBufferData with no data), the points
+    //are filled in by uploadCurve() as they arrive. The last parameter
+    //(GL_DYNAMIC_DRAW), says that we will be modifying these positions
+    //frequently at runtime.
+    gl.bindBuffer(GL_ARRAY_BUFFER, buffer);
+    gl.bufferData(
+            GL_ARRAY_BUFFER, //what kind of buffer (an array)
+            SLAB_CHUNKS * CurveStore::SLOTS * 3 * sizeof(float), //size of the buffer in bytes
+            NULL, //nothing to fill it with yet
+            GL_DYNAMIC_DRAW //how we intend to use the buffer
             );
-    glUniformMatrix4fv(shader->projectionLoc, 1, GL_FALSE,
-            glm::value_ptr(projection));
-    glUniformMatrix3fv(shader->normalMatrixLoc, 1, GL_FALSE,
-            glm::value_ptr(normalMatrix));
-    glUniform1f(shader->timeLoc, animTime);
-
-    glBindBuffer(GL_ARRAY_BUFFER, shader->vertexBuffer); //which buffer we want
-      //to use
-    glEnableVertexAttribArray(shader->vertexLoc); //enable the attribute
+    glEnableVertexAttribArray(POS_ATTRIB); //enable the attribute
     glVertexAttribPointer(
-            shader->vertexLoc, //handle to variable in shader program
+            POS_ATTRIB, //attribute location the shaders bind pos to
             3, //vector size (e.g. for texture coordinates this could be 2).
             GL_FLOAT, //what type of data is (e.g. GL_FLOAT, GL_INT, etc.)
             GL_FALSE, //normalize the data?
@@ -235,18 +218,718 @@ void display() {
               //also fine in general
             );
 
-    //same procedure for the normal array
-    glBindBuffer(GL_ARRAY_BUFFER, shader->normalBuffer);
-    glEnableVertexAttribArray(shader->normalLoc);
-    glVertexAttribPointer(shader->normalLoc, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    slabBuffers.push_back(buffer);
+    slabVAOs.push_back(vao);
+}
+
+//Sends the points added since the last call to the GPU. Each chunk of the
+//curve has a fixed place in a slab buffer, so only the new points are sent
+//and nothing on the GPU is ever moved either.
+void uploadCurve() {
+    while (uploaded < curveStore.size()) {
+        size_t k = uploaded / CurveStore::CHUNK, slab = k / SLAB_CHUNKS;
+        if (slab == slabBuffers.size()) addSlab();
+
+        //the points a chunk repeats go up with its first own points
+        size_t from = uploaded % CurveStore::CHUNK, to = curveStore.chunkSize(k);
+        size_t slot0 = from > 0 ? CurveStore::OVERLAP + from : 0;
+        size_t slot1 = CurveStore::OVERLAP + to;
+        size_t base = (k % SLAB_CHUNKS) * CurveStore::SLOTS;
+
+        gl.bindBuffer(GL_ARRAY_BUFFER, slabBuffers[slab]);
+        gl.bufferSubData(GL_ARRAY_BUFFER, (base + slot0) * 3 * sizeof(float),
+                (slot1 - slot0) * 3 * sizeof(float), curveStore.chunk(k) + 3 * slot0);
+        uploaded += to - from;
+    }
+}
+
+//Sizes the trail's ring for trailSize points, or frees it when not in trail
+//mode. The ring is kept after TRAIL_LEAD slots holding copies of its last
+//points, the way a chunk of the curve starts with the end of the one before,
+//so the strip drawn from the start of the ring joins up with its end.
+void resizeTrail() {
+    size_t slots = trailMode ? trailSize : 0;
+    if (slots == trailSlots) return;
+    if (!trailBuffer) {
+        glGenBuffers(1, &trailBuffer);
+        glGenVertexArrays(1, &trailVAO);
+        gl.bindVertexArray(trailVAO);
+        gl.bindBuffer(GL_ARRAY_BUFFER, trailBuffer);
+        glEnableVertexAttribArray(POS_ATTRIB);
+        glVertexAttribPointer(POS_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    }
+    gl.bindBuffer(GL_ARRAY_BUFFER, trailBuffer);
+    gl.bufferData(GL_ARRAY_BUFFER, slots > 0 ? (TRAIL_LEAD + slots) * 3 * sizeof(float) : 0,
+            NULL, GL_DYNAMIC_DRAW);
+    trailSlots = slots;
+}
+
+//writes n points to the trail's ring from index at, copying any of the last
+//TRAIL_LEAD into the leading slots as well
+void writeTrail(size_t at, size_t n, const float *xyz) {
+    gl.bindBuffer(GL_ARRAY_BUFFER, trailBuffer);
+    gl.bufferSubData(GL_ARRAY_BUFFER, (TRAIL_LEAD + at) * 3 * sizeof(float),
+            n * 3 * sizeof(float), xyz);
+    size_t end = trailSlots - TRAIL_LEAD;
+    if (at + n > end) {
+        size_t from = max(at, end);
+        gl.bufferSubData(GL_ARRAY_BUFFER, (from - end) * 3 * sizeof(float),
+                (at + n - from) * 3 * sizeof(float), xyz + 3 * (from - at));
+    }
+}
+
+//Adds count points to the trail, writing each over the oldest point once
+//the ring is full. Nothing grows, so a trail can run forever.
+void generateTrail(size_t count) {
+    while (count > 0) {
+        size_t n = min(count, trailSlots);
+        trailPoints.resize(3 * n);
+        curve->generate(n, trailPoints.data());
+
+        //at most two writes, up to the end of the ring and on from its start
+        size_t at = trailCount % trailSlots, m = min(n, trailSlots - at);
+        writeTrail(at, m, trailPoints.data());
+        if (m < n) writeTrail(0, n - m, trailPoints.data() + 3 * m);
+        trailCount += n;
+        count -= n;
+    }
+}
+
+//appends count points to the curve at once and uploads them
+void generatePoints(size_t count) {
+    if (trailMode) {
+        generateTrail(count);
+        updateCamera();
+        return;
+    }
+    while (count > 0) {
+        size_t n = count;
+        float *xyz = curveStore.reserve(n);
+        curve->generate(n, xyz);
+        curveStore.added(n);
+        count -= n;
+    }
+    curveIndex.update();
+    updateCamera();
+    uploadCurve();
+}
+
+//Sends the preview's current level to the GPU. A level is replaced whole
+//when it is finished, so the buffer is filled again rather than updated.
+void uploadPreview() {
+    if (!previewBuffer) {
+        glGenBuffers(1, &previewBuffer);
+        glGenVertexArrays(1, &previewVAO);
+        gl.bindVertexArray(previewVAO);
+        gl.bindBuffer(GL_ARRAY_BUFFER, previewBuffer);
+        glEnableVertexAttribArray(POS_ATTRIB);
+        glVertexAttribPointer(POS_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    }
+    gl.bindBuffer(GL_ARRAY_BUFFER, previewBuffer);
+    gl.bufferData(GL_ARRAY_BUFFER, preview.points().size() * sizeof(float),
+            preview.points().data(), GL_DYNAMIC_DRAW);
+    previewPoints = preview.size();
+    previewStale = true;
+}
 
+//makes the exposure of job, on the worker thread
+void makeExposure(ExposureJob *job) {
+    job->written = renderExposure(job->chain, job->h, job->samples, job->width, job->height,
+            job->file, job->out, &job->taken);
+    job->finished = true;
+}
 
-    update(deltaT);
+//starts an exposure of the current curve with the exposure controls' size,
+//samples and file, unless one is being made already
+void startExposure() {
+    if (exposureJob) {
+        cout << "An exposure is still being made, wait for it to finish" << endl;
+        return;
+    }
+    exposureJob = new ExposureJob;
+    exposureJob->chain = chain;
+    exposureJob->h = deltaT * S;
+    exposureJob->samples = uint64_t(exposureSamples) * 1000000;
+    exposureJob->width = exposureWidth;
+    exposureJob->height = exposureHeight;
+    exposureJob->file = exposureFile;
+    exposureJob->taken = 0;
+    exposureJob->finished = false;
+    exposureJob->written = false;
+    exposureWorker = new thread(makeExposure, exposureJob);
+}
 
-    //draw the vertices/normals we just specified.
-    glDrawArrays(GL_LINE_STRIP, 0, numVerts);
+//shows how far the exposure has got, and reports it once it is written
+void checkExposure() {
+    if (!exposureJob) return;
+    char text[128];
+    if (!exposureJob->finished) {
+        snprintf(text, sizeof(text), "Exposing %s: %d%%", exposureJob->file.c_str(),
+                int(100 * exposureJob->taken / max(exposureJob->samples, uint64_t(1))));
+        exposure_status->set_text(text);
+        return;
+    }
+
+    exposureWorker->join();
+    cout << exposureJob->out.str();
+    snprintf(text, sizeof(text), exposureJob->written ? "Saved %s" : "Couldn't save %s",
+            exposureJob->file.c_str());
+    exposure_status->set_text(text);
+    delete exposureWorker;
+    delete exposureJob;
+    exposureWorker = NULL;
+    exposureJob = NULL;
+}
+
+//updates values for the next step of the animation
+void update() {
+	//generate the next point of the spirograph
+    generatePoints(1);
+
+    //the preview's first level after a change, or the next slice of its
+    //refinement while the view can tell it from the last level
+    if (previewWanted() && preview.refine(PREVIEW_PER_FRAME, pixelSize())) uploadPreview();
+    checkExposure();
+    animTime = curve->step() * deltaT; //only used by the shader
+}
+
+//reshape function for GLUT
+void reshape(int w, int h) {
+    WIN_WIDTH = w;
+    WIN_HEIGHT = h;
+    projection = viewProjection(WIN_WIDTH, WIN_HEIGHT);
+}
+
+//Adds count points starting at slot of the current slab to the strips to
+//draw, continuing the last strip if it ends there. A new strip starts with the
+//lead points before its first point so it meets the one before: a plain strip
+//needs one of them, and the adjacency strip that gives the geometry shader the
+//neighbours of each segment for its joins needs three. Those before a chunk's
+//first point are in its leading slots.
+void addStrip(size_t slot, size_t count, size_t lead) {
+    drawnPoints += count;
+    if (!drawCount.empty() && size_t(drawFirst.back() + drawCount.back()) == slot) {
+        drawCount.back() += count;
+        return;
+    }
+    drawFirst.push_back(slot - lead);
+    drawCount.push_back(lead + count);
+}
+
+//how far past its points a line reaches, in normalized device coordinates of
+//a viewport size pixels across, with a pixel to spare
+float lineReach(int size) {
+    return (wideLines ? lineWidth + 2 : 2) / size;
+}
+
+//Puts the strips of the blocks of the preview in the frustum in drawFirst and
+//drawCount, as vertices of previewVAO when it steps over stride points at a
+//time, and returns how many points they hold. stride is a power of 2 no
+//larger than a block, so blocks start on a vertex.
+size_t cullPreview(const Frustum &frustum, size_t lead, size_t stride) {
+    drawFirst.clear();
+    drawCount.clear();
+    drawnPoints = 0;
+    size_t vertices = (previewPoints + stride - 1) / stride;
+    for (size_t b = 0; b * CurvePreview::BLOCK < previewPoints; b++) {
+        const CurvePreview::Box &box = preview.blockBox(b);
+        if (!frustum.intersects(box.lo, box.hi)) continue;
+        size_t start = b * CurvePreview::BLOCK / stride;
+        addStrip(start, min(vertices, (b + 1) * CurvePreview::BLOCK / stride) - start,
+                start > 0 ? lead : 0);
+    }
+    return drawnPoints;
+}
+
+//draws strips of previewVAO stepping over stride points a vertex
+void drawPreviewStrips(GLenum mode, size_t stride, const GLint *first, const GLsizei *count,
+        size_t strips) {
+    gl.bindVertexArray(previewVAO);
+    if (stride != previewStride) {
+        gl.bindBuffer(GL_ARRAY_BUFFER, previewBuffer);
+        glVertexAttribPointer(POS_ATTRIB, 3, GL_FLOAT, GL_FALSE, GLsizei(3 * sizeof(float) * stride), NULL);
+        previewStride = stride;
+    }
+    if (strips > 0) gl.multiDrawArrays(mode, first, count, strips);
+}
+
+//Draws the preview in a lighter color, culled by its blocks like the curve.
+//It is drawn into an image of the view, which is copied under each frame,
+//and no frame draws more than PREVIEW_PER_FRAME points of it. When a new
+//curve's first level arrives or the view or the lines change, the image is
+//drawn again at once from every stride-th point, few enough to fit, which
+//is the same as an earlier level. The whole level, and each level finished
+//later, is drawn into the other image PREVIEW_PER_FRAME points a frame, and
+//swapped in when it is complete. The current program and uniforms are used.
+void drawPreview(const Frustum &frustum, GLenum mode, size_t lead, int width, int height) {
+    glm::mat4 view = transforms.P * camera * modelView;
+    glm::vec3 lines(wideLines, lineWidth, roundJoins);
+    GLint bound; //the framebuffer the frame is drawn into
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &bound);
+    if (!previewFBO[0]) {
+        glGenFramebuffers(2, previewFBO);
+        glGenRenderbuffers(2, previewColor);
+    }
+    if (width != previewWidth || height != previewHeight) {
+        for (int i = 0; i < 2; i++) {
+            glBindRenderbuffer(GL_RENDERBUFFER, previewColor[i]);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+            gl.bindFramebuffer(previewFBO[i]);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                    previewColor[i]);
+        }
+        gl.bindFramebuffer(bound);
+        previewWidth = width;
+        previewHeight = height;
+        previewShown = false;
+    }
+    if (view != previewView || lines != previewLines) {
+        previewView = view;
+        previewLines = lines;
+        previewShown = false;
+    }
+
+    //drawn over the same color the frame was cleared to
+    gl.uniform(previewLoc[wideLines], 1);
+    gl.setEnabled(GL_BLEND, false);
+    size_t budget = PREVIEW_PER_FRAME;
+    if (!previewShown || previewStale) {
+        size_t points = cullPreview(frustum, lead, 1);
+        previewFirst.swap(drawFirst);
+        previewCount.swap(drawCount);
+        previewStrip = previewDrawn = 0;
+        previewStale = false;
+        if (!previewShown) {
+            size_t stride = 1;
+            while (points > stride * PREVIEW_PER_FRAME) stride *= 2;
+            if (stride > 1) points = cullPreview(frustum, lead, stride);
+            budget -= points;
+            gl.bindFramebuffer(previewFBO[previewFront]);
+            gl.clear(GL_COLOR_BUFFER_BIT);
+            if (stride > 1) {
+                drawPreviewStrips(mode, stride, drawFirst.data(), drawCount.data(), drawFirst.size());
+            } else {
+                //all of it fits, nothing is left for the other image
+                drawPreviewStrips(mode, 1, previewFirst.data(), previewCount.data(), previewFirst.size());
+                previewFirst.clear();
+                previewCount.clear();
+            }
+            previewShown = true;
+        }
+        if (!previewFirst.empty()) {
+            gl.bindFramebuffer(previewFBO[1 - previewFront]);
+            gl.clear(GL_COLOR_BUFFER_BIT);
+        }
+    }
+
+    //what is left of the budget goes on the level in the other image. A
+    //strip split between frames starts again lead points back, so the two
+    //parts meet.
+    if (budget > 0 && previewStrip < previewFirst.size()) {
+        drawFirst.clear();
+        drawCount.clear();
+        while (budget > 0 && previewStrip < previewFirst.size()) {
+            size_t left = previewCount[previewStrip] - previewDrawn;
+            size_t back = previewDrawn > 0 ? lead : 0;
+            size_t n = min(left, budget);
+            drawFirst.push_back(GLint(previewFirst[previewStrip] + previewDrawn - back));
+            drawCount.push_back(GLsizei(back + n));
+            budget -= n;
+            previewDrawn += n;
+            if (previewDrawn == size_t(previewCount[previewStrip])) {
+                ++previewStrip;
+                previewDrawn = 0;
+            }
+        }
+        gl.bindFramebuffer(previewFBO[1 - previewFront]);
+        drawPreviewStrips(mode, 1, drawFirst.data(), drawCount.data(), drawFirst.size());
+        if (previewStrip == previewFirst.size()) {
+            previewFront = 1 - previewFront;
+            previewFirst.clear();
+            previewCount.clear();
+        }
+    }
+    gl.uniform(previewLoc[wideLines], 0);
+    gl.bindFramebuffer(bound);
+    gl.blitFramebuffer(previewFBO[previewFront], width, height);
+}
+
+//draws the curve with the given projection into a viewport of the given size
+void drawCurve(const glm::mat4 &proj, int width, int height) {
+    //wide lines are drawn by the same vertex shader, with a geometry shader
+    //turning each segment into a quad
+    Shader *shader = wideLines ? wideShader : ::shader;
+
+    //Pass the matrices and animation time to the GPU in one upload
+    transforms.setModelView(camera * modelView);
+    transforms.P = proj;
+    transforms.time = animTime;
+    gl.bindBuffer(GL_UNIFORM_BUFFER, transformBuffer);
+    gl.bufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(transforms), &transforms);
+
+    //Tell OpenGL which shader program we want to use.
+    gl.useProgram(shader->program);
+    if (wideLines) {
+        gl.uniform(viewportLoc, float(width), float(height));
+        gl.uniform(lineWidthLoc, lineWidth);
+        gl.uniform(roundJoinLoc, roundJoins);
+    }
+
+    //the shader works out the age of each point of a trail from the ring
+    //index of the newest one, and it fades by blending
+    bool fade = trailMode && trailFade && trailSlots > 0;
+    gl.uniform(trailSizeLoc[wideLines], fade ? int(trailSlots) : 0);
+    if (fade) gl.uniform(trailNewestLoc[wideLines], int((trailCount + trailSlots - 1) % trailSlots));
+    gl.setEnabled(GL_BLEND, fade);
+    gl.uniform(previewLoc[wideLines], 0);
+
+    //Only the parts of the curve whose bounding box is in view are drawn,
+    //each run of them as one strip, with one multi-draw call for the strips
+    //in each slab. Groups of points entirely in or out of view are taken or
+    //skipped whole, and the blocks of the rest checked one by one.
+    Frustum frustum(proj * camera * modelView, lineReach(width), lineReach(height));
+    GLenum mode = wideLines ? GL_LINE_STRIP_ADJACENCY : GL_LINE_STRIP;
+    size_t lead = wideLines ? CurveStore::OVERLAP : 1;
+    size_t chunks = curveStore.chunkCount();
+
+    //the preview goes underneath, replacing what was cleared
+    if (previewWanted() && previewPoints > 0) {
+        drawPreview(frustum, mode, lead, width, height);
+        gl.setEnabled(GL_BLEND, fade);
+    }
+    drawnStrips = drawnPoints = 0;
+
+    //A trail is drawn from its oldest point, which is where the next point
+    //goes once the ring is full, to the end of the ring, then from the start
+    //of the ring on. The second strip starts in the leading slots so it
+    //joins the first. The ring's size bounds the cost, so it is not culled.
+    if (trailMode) {
+        size_t held = min(trailCount, uint64_t(trailSlots));
+        if (0 == held) return;
+        size_t oldest = held == trailSlots ? trailCount % trailSlots : 0;
+        drawFirst.clear();
+        drawCount.clear();
+        addStrip(TRAIL_LEAD + oldest, held - oldest, 0);
+        if (oldest > 0) addStrip(TRAIL_LEAD, oldest, lead);
+        drawnStrips = drawFirst.size();
+        gl.bindVertexArray(trailVAO);
+        gl.multiDrawArrays(mode, drawFirst.data(), drawCount.data(), drawFirst.size());
+        return;
+    }
+    for (size_t slab = 0; slab * SLAB_CHUNKS < chunks; slab++) {
+        drawFirst.clear();
+        drawCount.clear();
+        for (size_t k = slab * SLAB_CHUNKS; k < min(chunks, (slab + 1) * SLAB_CHUNKS); k++) {
+            //slot in the slab of the chunk's point 0 of the curve
+            size_t base = (k % SLAB_CHUNKS) * CurveStore::SLOTS + CurveStore::OVERLAP;
+            size_t first = k * CurveStore::CHUNK, end = first + curveStore.chunkSize(k);
+            for (size_t g = first / CurveStore::GROUP; g * CurveStore::GROUP < end; g++) {
+                const CurveStore::Box &box = curveStore.groupBox(g);
+                if (!frustum.intersects(box.lo, box.hi)) continue;
+
+                size_t from = g * CurveStore::GROUP, to = min(end, from + CurveStore::GROUP);
+                if (frustum.contains(box.lo, box.hi)) {
+                    addStrip(base + from - first, to - from, from > 0 ? lead : 0);
+                    continue;
+                }
+                for (size_t b = from / CurveStore::BLOCK; b * CurveStore::BLOCK < to; b++) {
+                    const CurveStore::Box &part = curveStore.blockBox(b);
+                    if (!frustum.intersects(part.lo, part.hi)) continue;
+                    size_t start = b * CurveStore::BLOCK;
+                    addStrip(base + start - first, min(to, start + CurveStore::BLOCK) - start,
+                            start > 0 ? lead : 0);
+                }
+            }
+        }
+        if (drawFirst.empty()) continue;
+        drawnStrips += drawFirst.size();
+
+        //the vertex array object remembers which buffer feeds each attribute
+        gl.bindVertexArray(slabVAOs[slab]);
+        gl.multiDrawArrays(mode, drawFirst.data(), drawCount.data(), drawFirst.size());
+    }
+}
+
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+//display function for GLUT
+void display() {
+    double start = seconds();
+    recorder.frame();
+    gl.viewport(0,0,WIN_WIDTH,WIN_HEIGHT);
+    gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    update();
+    gpuTimer.begin();
+    drawCurve(projection, WIN_WIDTH, WIN_HEIGHT);
+    gpuTimer.end();
+    if (showHud) hud.draw(gl, WIN_HEIGHT);
+    double cpuMs = 1e3 * (seconds() - start); //not counting the wait for the swap
 
     glutSwapBuffers();
+
+    gl.endFrame();
+    gpuTimer.poll();
+    hud.frame(cpuMs, gpuTimer, gl.lastFrame);
+    if (showStats && 0 == curve->step() % 60) {
+        cout << "GL calls per frame: " << gl.lastFrame.requested
+             << " requested, " << gl.lastFrame.issued << " issued; "
+             << gl.lastFrame.draws << " draw calls, " << drawnStrips << " strips, "
+             << 100 - 100.0 * drawnPoints / max(size_t(1), trailMode ?
+                     min(size_t(trailCount), trailSlots) : curveStore.size())
+             << "% of points culled" << endl;
+    }
+}
+
+//renders the curve at width x height pixels and writes it to a PPM file.
+//The image is drawn one tile at a time into an offscreen framebuffer and
+//each tile is written straight to its place in the file, so memory use does
+//not depend on the size of the image. Returns false if the file could not
+//be written, in which case it is incomplete.
+bool renderPoster(int width, int height, string file) {
+    PPMWriter out;
+    if (!out.open(file, width, height)) {
+        return false;
+    }
+
+    //tiles are as large as the driver allows, up to 2048 pixels
+    GLint maxSize, maxViewport[2];
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxSize);
+    glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+    int tile = min(2048, min(int(maxSize), min(int(maxViewport[0]), int(maxViewport[1]))));
+
+    //offscreen color and depth buffer for one tile
+    GLuint fbo, rbos[2];
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(2, rbos);
+    gl.bindFramebuffer(fbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbos[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, tile, tile);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbos[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbos[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, tile, tile);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbos[1]);
+
+    //same camera as the window, with the aspect ratio of the poster
+    glm::mat4 posterProj = viewProjection(width, height);
+
+    //keep wide lines the same thickness relative to the image as on screen
+    float screenLineWidth = lineWidth;
+    lineWidth *= float(height) / WIN_HEIGHT;
+
+    //only the curve itself goes on the poster
+    int screenPreview = showPreview;
+    showPreview = 0;
+
+    vector<unsigned char> pixels(size_t(tile) * tile * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    int start = glutGet(GLUT_ELAPSED_TIME);
+    int tiles = 0;
+    bool written = true;
+
+    //rows of tiles from the top of the image down
+    for (int top = 0; written && top < height; top += tile) {
+        int th = min(tile, height - top);
+        int y0 = height - top - th; //bottom of the tile in GL coordinates
+        for (int x0 = 0; written && x0 < width; x0 += tile) {
+            int tw = min(tile, width - x0);
+
+            //stretch the tile's part of the poster over the whole viewport
+            glm::mat4 tileProj = glm::translate(glm::mat4(1.0f), glm::vec3(
+                    float(width - 2*x0 - tw) / tw,
+                    float(height - 2*y0 - th) / th,
+                    0));
+            tileProj = glm::scale(tileProj, glm::vec3(float(width) / tw, float(height) / th, 1));
+
+            gl.viewport(0, 0, tw, th);
+            gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawCurve(tileProj * posterProj, tw, th);
+
+            glReadPixels(0, 0, tw, th, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+            written = out.writeRectFlipped(x0, top, tw, th, pixels.data());
+            ++tiles;
+        }
+    }
+    written = out.close() && written;
+
+    lineWidth = screenLineWidth;
+    showPreview = screenPreview;
+    gl.bindFramebuffer(0);
+    glDeleteRenderbuffers(2, rbos);
+    glDeleteFramebuffers(1, &fbo);
+
+    if (!written) {
+        cerr << "**ERROR** renderPoster: " << file << " is incomplete" << endl;
+        return false;
+    }
+    cout << "wrote " << width << "x" << height << " poster to " << file
+         << " in " << tiles << " tiles of " << tile << "x" << tile << " ("
+         << glutGet(GLUT_ELAPSED_TIME) - start << " ms, "
+         << pixels.size() / 1024 << " KB tile buffer)" << endl;
+    return true;
+}
+
+//times drawing count points as a line strip and as wide lines
+void benchmarkLines(size_t count) {
+    curveStore.clear();
+    uploaded = 0;
+    curveIndex.reset(chain, curve->stepSize());
+    curve->reset();
+    generatePoints(count);
+
+    const char *names[] = { "line strip", "wide, miter joins", "wide, round joins" };
+    const int frames = 20;
+    for (int mode = 0; mode < 3; mode++) {
+        wideLines = mode > 0;
+        roundJoins = mode > 1;
+
+        //first frame includes shader and buffer setup in the driver
+        gl.viewport(0,0,WIN_WIDTH,WIN_HEIGHT);
+        gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawCurve(projection, WIN_WIDTH, WIN_HEIGHT);
+        glFinish();
+
+        int start = glutGet(GLUT_ELAPSED_TIME);
+        for (int i = 0; i < frames; i++) {
+            gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawCurve(projection, WIN_WIDTH, WIN_HEIGHT);
+            glFinish();
+        }
+        int ms = glutGet(GLUT_ELAPSED_TIME) - start;
+        cout << names[mode] << ": " << float(ms) / frames << " ms/frame ("
+             << count << " vertices, " << lineWidth << " px)" << endl;
+    }
+}
+
+//Grows the curve to count points, perFrame points a frame, drawing all of it
+//every frame. Reports the mean and worst time spent adding the points
+//(generating, indexing and uploading them) and drawing.
+void benchmarkGrowth(size_t count, size_t perFrame) {
+    benchmarkStore(count, perFrame, cout);
+
+    curveStore.clear();
+    uploaded = 0;
+    curveIndex.reset(chain, curve->stepSize());
+    curve->reset();
+
+    double growTotal = 0, growWorst = 0, drawTotal = 0, drawWorst = 0, frameWorst = 0;
+    size_t frames = 0;
+    gl.viewport(0,0,WIN_WIDTH,WIN_HEIGHT);
+    for (size_t i = 0; i < count; i += perFrame) {
+        double start = seconds();
+        generatePoints(min(perFrame, count - i));
+        glFinish();
+        double grown = seconds();
+
+        gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawCurve(projection, WIN_WIDTH, WIN_HEIGHT);
+        glFinish();
+        double drawn = seconds();
+
+        growTotal += grown - start;
+        growWorst = max(growWorst, grown - start);
+        drawTotal += drawn - grown;
+        drawWorst = max(drawWorst, drawn - grown);
+        frameWorst = max(frameWorst, drawn - start);
+        ++frames;
+        gl.endFrame();
+    }
+    cout << "drawn every frame (" << gl.lastFrame.draws << " draw calls at the end):" << endl
+         << "  adding points: " << 1e3 * growTotal / frames << " ms mean, "
+         << 1e3 * growWorst << " ms worst" << endl
+         << "  drawing:       " << 1e3 * drawTotal / frames << " ms mean, "
+         << 1e3 * drawWorst << " ms worst" << endl
+         << "  worst frame:   " << 1e3 * frameWorst << " ms" << endl;
+}
+
+//Times drawing a count point curve zoomed in on one of its points, and
+//reports how much of the curve is culled at each zoom.
+void benchmarkZoom(size_t count) {
+    curveStore.clear();
+    uploaded = 0;
+    curveIndex.reset(chain, curve->stepSize());
+    curve->reset();
+    generatePoints(count);
+
+    const float *focus = curveStore.point(count / 2);
+    const int frames = 10;
+    for (float zoom = 1; zoom <= 256; zoom *= 4) {
+        viewZoom = zoom;
+        viewCenter = zoom > 1 ? glm::vec2(focus[0], focus[1]) : glm::vec2(0, 0);
+        updateCamera();
+
+        gl.viewport(0,0,WIN_WIDTH,WIN_HEIGHT);
+        gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawCurve(projection, WIN_WIDTH, WIN_HEIGHT);
+        glFinish();
+
+        double start = seconds();
+        for (int i = 0; i < frames; i++) {
+            gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawCurve(projection, WIN_WIDTH, WIN_HEIGHT);
+            glFinish();
+        }
+        double ms = 1e3 * (seconds() - start) / frames;
+        cout << "zoom " << zoom << ": " << ms << " ms/frame, " << drawnStrips << " strips, "
+             << drawnPoints << " of " << count << " points drawn ("
+             << 100 - 100.0 * drawnPoints / count << "% culled)" << endl;
+    }
+
+    viewZoom = 1;
+    viewCenter = glm::vec2(0, 0);
+    updateCamera();
+}
+
+//Runs a size point trail for count points, a tenth of the trail a frame,
+//drawing it every frame. Compares the first tenth of the frames after the
+//ring is full with the last tenth, as neither the time nor the memory of a
+//frame should grow after that.
+void benchmarkTrail(size_t count, size_t size) {
+    trailMode = 1;
+    trailSize = size;
+    trailCount = 0;
+    resizeTrail();
+    curve->reset();
+
+    size_t perFrame = max(size_t(1), size / 10);
+    size_t frames = (count + perFrame - 1) / perFrame;
+    size_t full = min(frames, (size + perFrame - 1) / perFrame); //first frame with the ring full
+    vector<double> times;
+    size_t uploadedFirst = 0, uploadedLast = 0;
+    gl.viewport(0,0,WIN_WIDTH,WIN_HEIGHT);
+    for (size_t i = 0; i < count; i += perFrame) {
+        double start = seconds();
+        generatePoints(min(perFrame, count - i));
+        gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawCurve(projection, WIN_WIDTH, WIN_HEIGHT);
+        glFinish();
+        times.push_back(seconds() - start);
+        if (times.size() == full + 1) uploadedFirst = gl.frame.bytesUploaded;
+        uploadedLast = gl.frame.bytesUploaded;
+        gl.endFrame();
+    }
+
+    cout << count << " points through a " << size << " point trail ("
+         << (TRAIL_LEAD + trailSlots) * 3 * sizeof(float) / 1024 << " KB), "
+         << perFrame << " points a frame:" << endl;
+    size_t tenth = max(size_t(1), frames / 10);
+    const char *names[] = { "first", "last" };
+    for (int part = 0; part < 2; part++) {
+        size_t from = part ? frames - tenth : min(full, frames - tenth);
+        double total = 0, worst = 0;
+        for (size_t i = from; i < from + tenth; i++) {
+            total += times[i];
+            worst = max(worst, times[i]);
+        }
+        cout << "  " << names[part] << " " << tenth << " frames: " << 1e3 * total / tenth
+             << " ms mean, " << 1e3 * worst << " ms worst, "
+             << (part ? uploadedLast : uploadedFirst) << " bytes uploaded" << endl;
+    }
+    cout << "  curve store: " << curveStore.memory() / 1024 << " KB" << endl;
 }
 
 //idle function for GLUT
@@ -255,12 +938,104 @@ void idle() {
     glutPostRedisplay();
 }
 
+//point of the curve's plane (z = 0) under window position (x, y)
+glm::vec2 windowToCurve(int x, int y) {
+    glm::vec4 viewport(0, 0, WIN_WIDTH, WIN_HEIGHT);
+    glm::vec3 a = glm::unProject(glm::vec3(x, WIN_HEIGHT - y, 0), camera * modelView, projection, viewport);
+    glm::vec3 b = glm::unProject(glm::vec3(x, WIN_HEIGHT - y, 1), camera * modelView, projection, viewport);
+    float s = a.z / (a.z - b.z);
+    return glm::vec2(a.x + s * (b.x - a.x), a.y + s * (b.y - a.y));
+}
+
+//finds the part of the curve under window position (x, y) and shows its
+//parameter, position and curvature. Returns false if there is none.
+bool pick(int x, int y) {
+    glm::vec2 q = windowToCurve(x, y);
+    float radius = glm::length(windowToCurve(x + PICK_PIXELS, y) - q);
+
+    CurveIndex::Hit hit;
+    if (!curve || !curveIndex.nearest(q.x, q.y, radius, hit)) {
+        pickText[0] = '\0';
+        pick_text->set_text(pickText);
+        return false;
+    }
+
+    //vertex i of the curve is at t = i*h
+    double t = (hit.segment + hit.u) * curve->stepSize();
+    Complex d1, d2;
+    curve->derivatives(t, d1, d2);
+    double curvature = (conj(d1) * d2).imag() / pow(abs(d1), 3);
+
+    snprintf(pickText, sizeof(pickText), "t = %.4f  (%.4f, %.4f)  curvature %.4g",
+            t, hit.x, hit.y, curvature);
+    pick_text->set_text(pickText);
+    return true;
+}
+
+//zooms the view by factor, keeping the point under window position (x, y)
+//where it is
+void zoomView(float factor, int x, int y) {
+    glm::vec2 before = windowToCurve(x, y);
+    viewZoom = min(10000.0f, max(0.5f, viewZoom * factor));
+    updateCamera();
+    viewCenter += before - windowToCurve(x, y);
+    updateCamera();
+    recorder.view(viewZoom, viewCenter.x, viewCenter.y);
+}
+
+//mouse button function for GLUT. Clicking prints the picked point, dragging
+//pans the view and the wheel zooms it about the mouse.
+void mouse(int button, int state, int x, int y) {
+    if (GLUT_LEFT_BUTTON == button) {
+        dragging = GLUT_DOWN == state;
+        dragX = x;
+        dragY = y;
+        if (dragging && pick(x, y)) {
+            cout << pickText << endl;
+        }
+    } else if (3 == button && GLUT_DOWN == state) { //freeglut reports the wheel as buttons 3 and 4
+        zoomView(1.25f, x, y);
+    } else if (4 == button && GLUT_DOWN == state) {
+        zoomView(0.8f, x, y);
+    }
+}
+
+//mouse motion function for GLUT with a button down, dragging pans the view
+void motion(int x, int y) {
+    if (!dragging) return;
+    viewCenter += windowToCurve(dragX, dragY) - windowToCurve(x, y);
+    dragX = x;
+    dragY = y;
+    updateCamera();
+    recorder.view(viewZoom, viewCenter.x, viewCenter.y);
+}
+
+//mouse motion function for GLUT, hovering shows the point under the mouse
+void passiveMotion(int x, int y) {
+    pick(x, y);
+}
+
 //captures keyborad input for GLUT
 void keyboard(unsigned char key, int x, int y) {
+    recorder.key(key);
     switch (key) {
     case 27:
         exit(0);
         break;
+    case 'g':
+        showStats = !showStats;
+        break;
+    case 'h':
+        showHud = !showHud;
+        break;
+    case 'p':
+        showPreview = !showPreview;
+        break;
+    case 'r':
+        viewZoom = 1;
+        viewCenter = glm::vec2(0, 0);
+        updateCamera();
+        break;
     }
 }
 
@@ -274,6 +1049,9 @@ void setupGLUT() {
     glutReshapeFunc(reshape);
     glutDisplayFunc(display);
     glutKeyboardFunc(keyboard);
+    glutMouseFunc(mouse);
+    glutMotionFunc(motion);
+    glutPassiveMotionFunc(passiveMotion);
     glutIdleFunc(idle);
     GLUI_Master.set_glutIdleFunc(idle);
 }
@@ -283,6 +1061,7 @@ void setupGL() {
 
 	//set clear color and intial values for a sample spirograph
     glClearColor(255.0f, 255.0f, 255.0f, 0.0f);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); //fading trails
     r = 0.0893;
     R = 1.854;
     p = 0.8;
@@ -294,89 +1073,474 @@ void setupShaders() {
     //create the shader program from a vertex and fragment shader
     shader = new Shader("shaders/gles.vert", "shaders/gles.frag");
 
-    //Here's where we setup handles to each variable that is used in the shader
-    //program. See the shader source code for more detail on what the difference
-    //is between uniform and vertex attribute variables.
-    shader->modelViewLoc = glGetUniformLocation(shader->program, "M");
-    shader->projectionLoc = glGetUniformLocation(shader->program, "P");
-    shader->normalMatrixLoc = glGetUniformLocation(shader->program, "M_n");
-    shader->timeLoc = glGetUniformLocation(shader->program, "time");
+    wideShader = new Shader("shaders/gles.vert", "shaders/wideline.geom",
+            "shaders/wideline.frag");
 
-    //notice that, since the vertex attribute norm is not used in the shader
-    //program, shader->normalLoc = -1. If we access norm in the shader program,
-    //then this value will be >= 0.
-    shader->vertexLoc = glGetAttribLocation(shader->program, "pos");
-    shader->normalLoc = glGetAttribLocation(shader->program, "norm");
+    //Here's where we setup handles to each uniform used by the wide line
+    //program. The matrices and time are in the Transform block and the
+    //vertex attributes are at the fixed locations from Renderer.hpp.
+    viewportLoc = wideShader->uniformLoc("viewport");
+    lineWidthLoc = wideShader->uniformLoc("lineWidth");
+    roundJoinLoc = wideShader->uniformLoc("roundJoin");
 
-    //Create buffers for the vertex and normal attribute arrays
-    GLuint bufs[2];
-    glGenBuffers(2, bufs);
+    //both programs share the vertex shader that fades trails
+    Shader *programs[2] = { shader, wideShader };
+    for (int i = 0; i < 2; i++) {
+        trailSizeLoc[i] = programs[i]->uniformLoc("trailSize");
+        trailNewestLoc[i] = programs[i]->uniformLoc("trailNewest");
+        previewLoc[i] = programs[i]->uniformLoc("preview");
+    }
 
-    shader->vertexBuffer = bufs[0];
-    shader->normalBuffer = bufs[1];
+    //Every point of the curve has the same normal, so it is a constant
+    //attribute rather than an array. The points are in the slab buffers
+    //made by addSlab().
+    glVertexAttrib3f(NORM_ATTRIB, 0, 0, 1);
 
-    //This is where we pass the vertex/normal data to the GPU.
-    //In genereal, the procedure for working with buffers is:
-    //  1. Tell OpenGL which buffer we're using (glBindBuffer)
-    //  2. Tell OpenGL what to do with the buffer (e.g. fill buffer, use the
-    //     in the buffer, etc).
-    //
-    //Here we are filling the buffers (glBufferData). The last parameter
-    //(GL_STATIC_DRAW), says that our intention is to not change the values in
-    //these buffers. If we were going to be modifying these positions frequently
-    //at runtime, we might want to make this GL_DYNAMIC_DRAW instead. For right
-    //now, it's not too important which you choose.
-
-    glBindBuffer(GL_ARRAY_BUFFER, shader->vertexBuffer);
-    glBufferData(
-            GL_ARRAY_BUFFER, //what kind of buffer (an array)
-            verts.size() * sizeof(float), //size of the buffer in bytes
-            verts.data(), //pointer to data we want to fill the buffer with
-            GL_DYNAMIC_DRAW //how we intend to use the buffer
-            );
+    //uniform buffer for the Transform block of every program
+    glGenBuffers(1, &transformBuffer);
+    gl.bindBuffer(GL_UNIFORM_BUFFER, transformBuffer);
+    gl.bufferData(GL_UNIFORM_BUFFER, sizeof(TransformBlock), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, TRANSFORM_BINDING, transformBuffer);
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, shader->normalBuffer);
-    glBufferData(
-            GL_ARRAY_BUFFER,
-            norms.size() * sizeof(float),
-            norms.data(),
-            GL_DYNAMIC_DRAW
-            );
+//rebuilds the chain from the preset and the wheel variables
+void buildChain() {
+    switch (preset) {
+    case CLASSIC: chain = classicChain(r, R, p); break;
+    case HYPOTROCHOID: chain = hypotrochoid(r, R, p); break;
+    case EPITROCHOID: chain = epitrochoid(r, R, p); break;
+    case NESTED_WHEELS: chain = nestedWheels(wheels, symmetry); break;
+    case HARMONOGRAPH: chain = harmonograph(); break;
+    default: break; //CUSTOM chains are only changed by the term editor
+    }
+}
+
+//copies the selected term into the term editor
+void showTerm() {
+    if (termIdx >= int(chain.size())) termIdx = chain.size() - 1;
+    if (termIdx < 0) termIdx = 0;
+    term_spinner->set_int_limits(0, chain.size() - 1, GLUI_LIMIT_CLAMP);
+
+    const Term &term = chain[termIdx];
+    termAmp = abs(term.amp);
+    termPhase = arg(term.amp) * 180 / M_PI;
+    termFreq = term.freq;
+    termDamp = term.damp;
+    glui->sync_live();
+}
+
+//starts drawing the current chain over from t = 0
+void restartCurve() {
+    curveStore.clear();
+    uploaded = 0;
+    curveIndex.reset(chain, deltaT * S);
+    delete curve;
+    curve = makeGenerator(chain, deltaT * S);
+    curve->mode = usePhasor ? CurveGenerator::PHASOR : CurveGenerator::DIRECT;
+    trailCount = 0;
+    resizeTrail();
+
+    //drops the last curve's preview, the new one is made over the next
+    //frames
+    preview.reset(chain, deltaT * S);
+    previewPoints = 0;
+    previewShown = false;
+}
+
+//values of the controls that change what is drawn, in the order recordings
+//store them
+const size_t CONTROL_COUNT = 19;
+vector<float> saveControls() {
+    float values[CONTROL_COUNT] = {
+        r, R, p, S, float(usePhasor), float(preset), float(wheels), float(symmetry),
+        float(termIdx), termAmp, termPhase, termFreq, termDamp,
+        float(wideLines), float(roundJoins), lineWidth,
+        float(trailMode), float(trailSize), float(trailFade)
+    };
+    return vector<float>(values, values + CONTROL_COUNT);
+}
+
+//sets the controls from values saved by saveControls()
+void loadControls(const vector<float> &values) {
+    if (values.size() != CONTROL_COUNT) return;
+    const float *v = values.data();
+    r = v[0]; R = v[1]; p = v[2]; S = v[3];
+    usePhasor = int(v[4]); preset = int(v[5]); wheels = int(v[6]); symmetry = int(v[7]);
+    termIdx = int(v[8]); termAmp = v[9]; termPhase = v[10]; termFreq = v[11]; termDamp = v[12];
+    wideLines = int(v[13]); roundJoins = int(v[14]); lineWidth = v[15];
+    trailMode = int(v[16]); trailSize = int(v[17]); trailFade = int(v[18]);
+    glui->sync_live();
 }
 
 //function to clear the current spirograph when a variable is altered.
 void clear( int ID)
 {
-	verts.clear();
+    //everything but saving an image changes what is drawn
+    if (POSTER_ID != ID && EXPOSURE_ID != ID) recorder.control(ID, saveControls());
+
+    switch (ID) {
+    case LINES_ID:
+    case FADE_ID:
+        return; //read when the curve is drawn
+    case TERM_ID:
+        showTerm();
+        return; //only changes what the editor shows
+    case POSTER_ID:
+        renderPoster(posterWidth, posterHeight, posterFile);
+        return;
+    case EXPOSURE_ID:
+        startExposure();
+        return;
+    case TERM_EDIT_ID:
+        chain[termIdx] = Term(polar(double(termAmp), termPhase * M_PI / 180),
+                termFreq, termDamp);
+        preset = CUSTOM;
+        break;
+    case ADD_TERM_ID:
+        chain.push_back(Term(0.25, chain.size() + 1));
+        termIdx = chain.size() - 1;
+        preset = CUSTOM;
+        break;
+    case REMOVE_TERM_ID:
+        if (chain.size() > 1) {
+            chain.erase(chain.begin() + termIdx);
+            preset = CUSTOM;
+        }
+        break;
+    default:
+        buildChain();
+        break;
+    }
+    showTerm();
+    restartCurve();
+}
+
+//Plays back a recording made with --record instead of running the window.
+//The events recorded before each frame are applied, then the frame adds a
+//point and draws the curve into an offscreen framebuffer. A frame always
+//adds exactly one point, so the result does not depend on how fast frames
+//are drawn. Prints the frame times and a hash of the last frame, and writes
+//the time of every frame to timingFile if it is not empty. Returns false if
+//the recording could not be opened or is damaged.
+bool replay(string file, string timingFile) {
+    Recorder in;
+    if (!in.replay(file)) {
+        return false;
+    }
+
+    //the window may not be shown, so draw where the pixels are defined
+    GLuint fbo, rbos[2];
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(2, rbos);
+    gl.bindFramebuffer(fbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbos[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIN_WIDTH, WIN_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, rbos[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, rbos[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WIN_WIDTH, WIN_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbos[1]);
+
+    Recorder::Event e;
+    vector<double> times;
+    double recorded = 0;
+    bool quit = false;
+    while (!quit && in.next(e)) {
+        switch (e.kind) {
+        case Recorder::CONTROL:
+            loadControls(e.values);
+            clear(e.id);
+            break;
+        case Recorder::KEY:
+            if (27 == e.key) {
+                quit = true; //Esc ended the session
+            } else {
+                keyboard(e.key, 0, 0);
+            }
+            break;
+        case Recorder::VIEW:
+            viewZoom = e.zoom;
+            viewCenter = glm::vec2(e.center[0], e.center[1]);
+            updateCamera();
+            break;
+        case Recorder::FRAME: {
+            double start = seconds();
+            gl.viewport(0,0,WIN_WIDTH,WIN_HEIGHT);
+            gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            update();
+            gpuTimer.begin();
+            drawCurve(projection, WIN_WIDTH, WIN_HEIGHT);
+            gpuTimer.end();
+            glFinish();
+            times.push_back(seconds() - start);
+            gpuTimer.poll();
+            recorded += 1e-6 * e.micros;
+            gl.endFrame();
+            break;
+        }
+        }
+    }
+
+    vector<unsigned char> pixels(size_t(WIN_WIDTH) * WIN_HEIGHT * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, WIN_WIDTH, WIN_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    gl.bindFramebuffer(0);
+    glDeleteRenderbuffers(2, rbos);
+    glDeleteFramebuffers(1, &fbo);
+
+    if (in.failed()) {
+        cerr << "**ERROR** replay: " << file << " is damaged, only " << times.size()
+             << " frames could be replayed" << endl;
+        return false;
+    }
+
+    if (!timingFile.empty()) {
+        ofstream out(timingFile.c_str());
+        for (size_t i = 0; i < times.size(); i++) {
+            out << 1e3 * times[i] << endl;
+        }
+    }
+
+    double total = 0;
+    for (size_t i = 0; i < times.size(); i++) total += times[i];
+    vector<double> sorted(times);
+    sort(sorted.begin(), sorted.end());
+    cout << "replayed " << times.size() << " frames of " << file;
+    if (!times.empty()) {
+        cout << ": " << 1e3 * total / times.size() << " ms mean, "
+             << 1e3 * sorted[sorted.size() * 99 / 100] << " ms 99%, "
+             << 1e3 * sorted.back() << " ms worst (recorded "
+             << 1e3 * recorded / times.size() << " ms mean)";
+    }
+    if (gpuTimer.results > 0) {
+        cout << endl << "GPU " << gpuTimer.totalMs / gpuTimer.results << " ms mean over "
+             << gpuTimer.results << " frames";
+    }
+    char hash[32];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)fnv1a(pixels.data(), pixels.size()));
+    cout << endl << "framebuffer hash " << hash << endl;
+    return true;
 }
 
 int main(int argc, char **argv) {
+    //--bench-curve [steps] compares phasor and direct point generation
+    if (argc > 1 && string(argv[1]) == "--bench-curve") {
+        uint64_t steps = argc > 2 ? strtoull(argv[2], NULL, 10) : 100000000;
+        benchmarkCurve(classicChain(0.0893, 1.854, 0.8), deltaT, steps, cout);
+        benchmarkCurve(nestedWheels(5, 5), deltaT, steps, cout);
+        benchmarkCurve(harmonograph(), deltaT, steps, cout);
+        benchmarkTimeDrift(deltaT, steps, cout);
+        return 0;
+    }
+
+    //--bench-pick [count] times building the picking index and querying it
+    if (argc > 1 && string(argv[1]) == "--bench-pick") {
+        size_t count = argc > 2 ? strtoull(argv[2], NULL, 10) : 10000000;
+        benchmarkIndex(classicChain(0.0893, 1.854, 0.8), deltaT, count, cout);
+        benchmarkIndex(nestedWheels(5, 5), deltaT, count, cout);
+        return 0;
+    }
+
+    //--check-recorder [file] checks reading back recordings, whole and cut
+    //short, using file as scratch space
+    if (argc > 1 && string(argv[1]) == "--check-recorder") {
+        return checkRecorder(argc > 2 ? argv[2] : "check.rec", cout) ? 0 : 1;
+    }
+
+    //--bench-preview [perFrame] times making and refining the preview of
+    //each preset, perFrame points a frame
+    if (argc > 1 && string(argv[1]) == "--bench-preview") {
+        size_t perFrame = argc > 2 ? strtoull(argv[2], NULL, 10) : PREVIEW_PER_FRAME;
+        benchmarkPreview(classicChain(0.0893, 1.854, 0.8), deltaT, perFrame, WIN_HEIGHT, cout);
+        benchmarkPreview(hypotrochoid(0.0893, 1.854, 0.8), deltaT, perFrame, WIN_HEIGHT, cout);
+        benchmarkPreview(nestedWheels(4, 5), deltaT, perFrame, WIN_HEIGHT, cout);
+        benchmarkPreview(harmonograph(), deltaT, perFrame, WIN_HEIGHT, cout);
+        return 0;
+    }
+
+    //--exposure width height file [samples] renders a long exposure of the
+    //curve
+    if (argc > 4 && string(argv[1]) == "--exposure") {
+        uint64_t samples = argc > 5 ? strtoull(argv[5], NULL, 10) : 100000000;
+        return renderExposure(classicChain(0.0893, 1.854, 0.8), deltaT, samples,
+                atoi(argv[2]), atoi(argv[3]), argv[4], cout) ? 0 : 1;
+    }
+
+    //--bench-lines [count] times wide lines against the plain line strip
+    size_t benchLines = 0;
+    if (argc > 1 && string(argv[1]) == "--bench-lines") {
+        benchLines = argc > 2 ? strtoull(argv[2], NULL, 10) : 1000000;
+    }
+
+    //--bench-growth [count] [perFrame] grows the curve to count points,
+    //perFrame points a frame, and reports the worst frame
+    size_t benchGrowth = 0, growthPerFrame = 100000;
+    if (argc > 1 && string(argv[1]) == "--bench-growth") {
+        benchGrowth = argc > 2 ? strtoull(argv[2], NULL, 10) : 50000000;
+        if (argc > 3) growthPerFrame = max(1ull, strtoull(argv[3], NULL, 10));
+    }
+
+    //--bench-zoom [count] times drawing zoomed in views of a count point curve
+    size_t benchZoom = 0;
+    if (argc > 1 && string(argv[1]) == "--bench-zoom") {
+        benchZoom = argc > 2 ? strtoull(argv[2], NULL, 10) : 10000000;
+    }
+
+    //--bench-trail [count] [size] runs count points through a size point
+    //trail
+    size_t benchTrail = 0, benchTrailSize = 100000;
+    if (argc > 1 && string(argv[1]) == "--bench-trail") {
+        benchTrail = argc > 2 ? strtoull(argv[2], NULL, 10) : 10000000;
+        if (argc > 3) benchTrailSize = max(16ull, strtoull(argv[3], NULL, 10));
+    }
+
+    //--trail [points] starts in trail mode, keeping only the newest points
+    if (argc > 1 && string(argv[1]) == "--trail") {
+        trailMode = 1;
+        if (argc > 2) trailSize = max(16, atoi(argv[2]));
+    }
+
+    //--poster width height file [points] draws points of the curve and saves
+    //them as a poster
+    size_t posterPoints = 0;
+    if (argc > 4 && string(argv[1]) == "--poster") {
+        posterWidth = atoi(argv[2]);
+        posterHeight = atoi(argv[3]);
+        posterPoints = argc > 5 ? strtoull(argv[5], NULL, 10) : 100000;
+    }
+
+    //--record file saves the controls changed, keys pressed and frames drawn,
+    //--replay file [timings] plays them back without waiting for the window
+    string recordFile, replayFile, timingFile;
+    if (argc > 2 && string(argv[1]) == "--record") {
+        recordFile = argv[2];
+    }
+    if (argc > 2 && string(argv[1]) == "--replay") {
+        replayFile = argv[2];
+        if (argc > 3) timingFile = argv[3];
+    }
+
     glutInit(&argc, argv);
     setupGLUT();
     setupGL();
     glewInit();
 
     //create the GLUI window
-    GLUI *glui = GLUI_Master.create_glui( "GLUI", 0, 850, 100);
-    GLUI_Spinner *r_spinner = glui->add_spinner("Radius 1",GLUI_SPINNER_FLOAT,&r,0,clear);
+    glui = GLUI_Master.create_glui( "GLUI", 0, 850, 100);
+    GLUI_Listbox *preset_list = glui->add_listbox("Curve",&preset,PRESET_ID,clear);
+    preset_list->add_item(CLASSIC, "Classic");
+    preset_list->add_item(HYPOTROCHOID, "Hypotrochoid");
+    preset_list->add_item(EPITROCHOID, "Epitrochoid");
+    preset_list->add_item(NESTED_WHEELS, "Nested wheels");
+    preset_list->add_item(HARMONOGRAPH, "Harmonograph");
+    preset_list->add_item(CUSTOM, "Custom");
+    GLUI_Spinner *r_spinner = glui->add_spinner("Radius 1",GLUI_SPINNER_FLOAT,&r,RADIUS1_ID,clear);
     r_spinner->set_float_limits(-100,100,GLUI_LIMIT_CLAMP);
     r_spinner->set_speed(0.001f);
-    GLUI_Spinner *R_spinner = glui->add_spinner("Radius 2",GLUI_SPINNER_FLOAT,&R,1,clear);
+    GLUI_Spinner *R_spinner = glui->add_spinner("Radius 2",GLUI_SPINNER_FLOAT,&R,RADIUS2_ID,clear);
     R_spinner->set_float_limits(-100,100,GLUI_LIMIT_CLAMP);
     R_spinner->set_speed(0.001f);
-    GLUI_Spinner *p_spinner = glui->add_spinner("Pen Distance",GLUI_SPINNER_FLOAT,&p,2,clear);
+    GLUI_Spinner *p_spinner = glui->add_spinner("Pen Distance",GLUI_SPINNER_FLOAT,&p,PEN_ID,clear);
     p_spinner->set_float_limits(-50,50,GLUI_LIMIT_CLAMP);
     p_spinner->set_speed(0.001f);
-    GLUI_Spinner *S_spinner = glui->add_spinner("Step Size",GLUI_SPINNER_FLOAT,&S,3,clear);
+    GLUI_Spinner *S_spinner = glui->add_spinner("Step Size",GLUI_SPINNER_FLOAT,&S,STEP_ID,clear);
     S_spinner->set_float_limits(-100,100,GLUI_LIMIT_CLAMP);
     S_spinner->set_speed(0.001f);
+    GLUI_Spinner *wheels_spinner = glui->add_spinner("Wheels",GLUI_SPINNER_INT,&wheels,WHEELS_ID,clear);
+    wheels_spinner->set_int_limits(1,12,GLUI_LIMIT_CLAMP);
+    GLUI_Spinner *symmetry_spinner = glui->add_spinner("Symmetry",GLUI_SPINNER_INT,&symmetry,WHEELS_ID,clear);
+    symmetry_spinner->set_int_limits(1,24,GLUI_LIMIT_CLAMP);
+    glui->add_checkbox("Phasor",&usePhasor,PHASOR_ID,clear);
+
+    //editor for the individual terms of the chain
+    GLUI_Panel *term_panel = glui->add_panel("Terms");
+    term_spinner = glui->add_spinner_to_panel(term_panel,"Term",GLUI_SPINNER_INT,&termIdx,TERM_ID,clear);
+    GLUI_Spinner *amp_spinner = glui->add_spinner_to_panel(term_panel,"Radius",GLUI_SPINNER_FLOAT,&termAmp,TERM_EDIT_ID,clear);
+    amp_spinner->set_float_limits(0,100,GLUI_LIMIT_CLAMP);
+    amp_spinner->set_speed(0.001f);
+    GLUI_Spinner *phase_spinner = glui->add_spinner_to_panel(term_panel,"Angle",GLUI_SPINNER_FLOAT,&termPhase,TERM_EDIT_ID,clear);
+    phase_spinner->set_float_limits(-180,180,GLUI_LIMIT_WRAP);
+    GLUI_Spinner *freq_spinner = glui->add_spinner_to_panel(term_panel,"Speed",GLUI_SPINNER_FLOAT,&termFreq,TERM_EDIT_ID,clear);
+    freq_spinner->set_float_limits(-100,100,GLUI_LIMIT_CLAMP);
+    freq_spinner->set_speed(0.001f);
+    GLUI_Spinner *damp_spinner = glui->add_spinner_to_panel(term_panel,"Damping",GLUI_SPINNER_FLOAT,&termDamp,TERM_EDIT_ID,clear);
+    damp_spinner->set_float_limits(0,1,GLUI_LIMIT_CLAMP);
+    damp_spinner->set_speed(0.001f);
+    glui->add_button_to_panel(term_panel,"Add Term",ADD_TERM_ID,clear);
+    glui->add_button_to_panel(term_panel,"Remove Term",REMOVE_TERM_ID,clear);
+
+    GLUI_Panel *line_panel = glui->add_panel("Lines");
+    glui->add_checkbox_to_panel(line_panel,"Wide Lines",&wideLines,LINES_ID,clear);
+    glui->add_checkbox_to_panel(line_panel,"Round Joins",&roundJoins,LINES_ID,clear);
+    GLUI_Spinner *width_spinner = glui->add_spinner_to_panel(line_panel,"Line Width",GLUI_SPINNER_FLOAT,&lineWidth,LINES_ID,clear);
+    width_spinner->set_float_limits(1,64,GLUI_LIMIT_CLAMP);
+
+    GLUI_Panel *trail_panel = glui->add_panel("Trail");
+    glui->add_checkbox_to_panel(trail_panel,"Trail",&trailMode,TRAIL_ID,clear);
+    GLUI_Spinner *trail_spinner = glui->add_spinner_to_panel(trail_panel,"Points",GLUI_SPINNER_INT,&trailSize,TRAIL_ID,clear);
+    trail_spinner->set_int_limits(16,10000000,GLUI_LIMIT_CLAMP);
+    glui->add_checkbox_to_panel(trail_panel,"Fade",&trailFade,FADE_ID,clear);
+
+    GLUI_Panel *poster_panel = glui->add_panel("Poster");
+    GLUI_Spinner *pw_spinner = glui->add_spinner_to_panel(poster_panel,"Width",GLUI_SPINNER_INT,&posterWidth);
+    pw_spinner->set_int_limits(1,65535,GLUI_LIMIT_CLAMP);
+    GLUI_Spinner *ph_spinner = glui->add_spinner_to_panel(poster_panel,"Height",GLUI_SPINNER_INT,&posterHeight);
+    ph_spinner->set_int_limits(1,65535,GLUI_LIMIT_CLAMP);
+    GLUI_EditText *file_text = glui->add_edittext_to_panel(poster_panel,"File",GLUI_EDITTEXT_TEXT,posterFile);
+    file_text->set_w(200);
+    glui->add_button_to_panel(poster_panel,"Save Poster",POSTER_ID,clear);
+
+    GLUI_Panel *exposure_panel = glui->add_panel("Exposure");
+    GLUI_Spinner *ew_spinner = glui->add_spinner_to_panel(exposure_panel,"Width",GLUI_SPINNER_INT,&exposureWidth);
+    ew_spinner->set_int_limits(1,16384,GLUI_LIMIT_CLAMP);
+    GLUI_Spinner *eh_spinner = glui->add_spinner_to_panel(exposure_panel,"Height",GLUI_SPINNER_INT,&exposureHeight);
+    eh_spinner->set_int_limits(1,16384,GLUI_LIMIT_CLAMP);
+    GLUI_Spinner *samples_spinner = glui->add_spinner_to_panel(exposure_panel,"Samples (M)",GLUI_SPINNER_INT,&exposureSamples);
+    samples_spinner->set_int_limits(1,100000,GLUI_LIMIT_CLAMP);
+    GLUI_EditText *exposure_text = glui->add_edittext_to_panel(exposure_panel,"File",GLUI_EDITTEXT_TEXT,exposureFile);
+    exposure_text->set_w(200);
+    glui->add_button_to_panel(exposure_panel,"Save Exposure",EXPOSURE_ID,clear);
+    exposure_status = glui->add_statictext_to_panel(exposure_panel,"");
+    exposure_status->set_w(200);
+
+    //filled in by pick() when the mouse is over the curve
+    pick_text = glui->add_statictext("");
+    pick_text->set_w(320);
 
     glui->set_main_gfx_window( main_window );
 
     setupShaders();
+    if (!recordFile.empty() && !recorder.record(recordFile)) {
+        return 1;
+    }
+    clear(PRESET_ID);
+    if (!replayFile.empty()) {
+        return replay(replayFile, timingFile) ? 0 : 1;
+    }
+    if (benchLines) {
+        benchmarkLines(benchLines);
+        return 0;
+    }
+    if (benchZoom) {
+        benchmarkZoom(benchZoom);
+        return 0;
+    }
+    if (benchGrowth) {
+        benchmarkGrowth(benchGrowth, growthPerFrame);
+        return 0;
+    }
+    if (benchTrail) {
+        benchmarkTrail(benchTrail, benchTrailSize);
+        return 0;
+    }
+    if (posterPoints) {
+        generatePoints(posterPoints);
+        return renderPoster(posterWidth, posterHeight, argv[4]) ? 0 : 1;
+    }
     glutMainLoop();
 
     if (shader) delete shader;
+    if (wideShader) delete wideShader;
+    if (curve) delete curve;
 
     return 0;
 }
@@ -10,6 +10,10 @@
 #include <GL/freeglut.h>
 #include <GL/gl.h>
 
+#include "Curve.hpp"
+#include "Renderer.hpp"
+#include "TubeMesh.hpp"
+
 #define GLM_SWIZZLE
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -17,124 +21,28 @@
 #include <glm/gtc/matrix_access.hpp>
 
 #include <cmath>
+#include <cstdlib>
+#include <ctime>
 
 #include <iostream>
 #include <vector>
 #include <string>
-#include <fstream>
 using namespace std;
 
-/**
- * Simple class for keeping track of shader program and vertex attribute
- * locations.
- */
-class Shader {
-public:
-    Shader(string vertFile, string fragFile) { fromFiles(vertFile, fragFile); }
-
-    /**
-     * Creates a shader program based on vertex and fragment source.
-     *
-     * @param vertFile Path to vertex source
-     * @param fragFile Path to fragment source
-     */
-    void fromFiles(string vertFile, string fragFile) {
-        //These are shader objects containing the shader source code
-        GLint vSource = setShaderSource(vertFile, GL_VERTEX_SHADER);
-        GLint fSource = setShaderSource(fragFile, GL_FRAGMENT_SHADER);
-
-        //Create a new shader program
-        program = glCreateProgram();
-
-        //Compile the source code for each shader and attach it to the program.
-        glCompileShader(vSource);
-        printLog("vertex compile log: ", vSource);
-        glAttachShader(program, vSource);
-
-        glCompileShader(fSource);
-        printLog("fragment compile log: ", fSource);
-        glAttachShader(program, fSource);
-
-        //we could attach more shaders, such as a geometry or tessellation
-        //shader here.
-
-        //link all of the attached shader objects
-        glLinkProgram(program);
-    }
-
-    /**
-     * Helper method for reading in the source for a shader and creating a
-     * shader object.
-     *
-     * @param file Filename of shader source
-     * @param type Type of shader-> Only GL_VERTEX_SHADER and GL_FRAGMENT_SHADER
-     *   are supported here.
-     */
-    GLint setShaderSource(string file, GLenum type) {
-        //read source code
-        ifstream fin(file.c_str());
-        if (fin.fail()) {
-            cerr << "Could not open " << file << " for reading" << endl;
-            return -1;
-        }
-        fin.seekg(0, ios::end);
-        int count  = fin.tellg();
-        char *data = NULL;
-        if (count > 0) {
-            fin.seekg(ios::beg);
-            data = new char[count+1];
-            fin.read(data,count);
-            data[count] = '\0';
-        }
-        fin.close();
-
-        //create the shader
-        GLint s = glCreateShader(type);
-        glShaderSource(s, 1, const_cast<const char **>(&data), NULL);
-        delete [] data;
-        return s;
-    }
-
-    /**
-     * Helper function used for debugging.
-     */
-    void printLog(std::string label, GLint obj) {
-        int infologLength = 0;
-        int maxLength;
-
-        if(glIsShader(obj)) {
-            glGetShaderiv(obj,GL_INFO_LOG_LENGTH,&maxLength);
-        } else {
-            glGetProgramiv(obj,GL_INFO_LOG_LENGTH,&maxLength);
-        }
-
-        char infoLog[maxLength];
-
-        if (glIsShader(obj)) {
-            glGetShaderInfoLog(obj, maxLength, &infologLength, infoLog);
-        } else {
-            glGetProgramInfoLog(obj, maxLength, &infologLength, infoLog);
-        }
-
-        if (infologLength > 0) {
-            cerr << label << infoLog << endl;
-        }
-    }
-
-    GLint program; //shader program
-    GLint modelViewLoc; //location of the modelview matrix in the program (M)
-    GLint projectionLoc; //location of the projection matrix in the program (P)
-    GLint normalMatrixLoc; //location of the normal matrix in the program (M_n)
-    GLint vertexLoc, normalLoc; //vertex attribute locations (pos and norm)
-      //respectively
-    GLint colorLoc;
-    GLint timeLoc; //location of time variable
-    GLint lightPosLoc;
-    GLint viewPosLoc;
-    GLuint vertexBuffer, normalBuffer; //used to keep track of GL buffer objects
-    GLuint colorBuffer;
-};
 Shader *shader = NULL;
+GLState gl; //cached GL state, all drawing goes through here
+TransformBlock transforms; //contents of the Transform uniform buffer
+GLuint transformBuffer; //uniform buffer holding transforms
+GLuint triangleVAO; //vertex array object for the triangle
+GLuint tubeVAO; //vertex array object for the tube
+GLuint tubeBuffers[4]; //tube vertex, normal, color and index buffers
+size_t tubeCapacity = 0; //rings the tube buffers have room for
+size_t uploadedRings = 0; //rings of the tube already in the buffers
+int showStats = 0; //print GL call counts every second if set
+int showHud = 0; //draw frame timings over the picture if set
+GpuTimer gpuTimer; //times drawing the tube or triangle on the GPU
+Hud hud; //frame timings drawn over the picture
+int frameCount = 0;
 
 int WIN_WIDTH = 1280, WIN_HEIGHT = 720; //window width/height
 glm::mat4 modelView, projection, camera; //matrices for shaders
@@ -146,6 +54,92 @@ vector<float> norms; //normal array
 vector<float> colors; //normal array
 size_t numVerts; //number of total vertices
 
+int tubeMode = 1; //draw the spirograph as a tube instead of the triangle
+int liftTube = 1; //raise the tube in z as t increases
+const double CURVE_STEP = 0.001; //t between points of the spirograph
+const double LIFT = 0.02; //rise in z per unit of t
+const size_t POINTS_PER_FRAME = 16; //points added to the tube each frame
+const size_t MAX_TUBE_POINTS = 1 << 16; //longest tube kept while it grows
+Chain chain = classicChain(0.0893, 1.854, 0.8); //curve the tube follows
+CurveGenerator *curve = NULL; //generates the points of the curve
+vector<float> path; //points of the curve so far
+TubeMesh tube; //tube swept along path
+
+//copies the rings added to the tube since the last call into the tube
+//buffers, making the buffers twice as large when they run out of room, up
+//to MAX_TUBE_POINTS rings unless a longer tube is asked for
+void uploadTube() {
+    size_t rings = tube.rings();
+    if (rings == uploadedRings) return;
+    if (rings > tubeCapacity) {
+        tubeCapacity = max(rings, min(max(size_t(1024), 2 * rings), MAX_TUBE_POINTS));
+        uploadedRings = 0;
+    }
+    size_t n = tube.sides; //vertices per ring
+    size_t first = uploadedRings * n, count = (rings - uploadedRings) * n;
+    size_t firstIndex = uploadedRings > 0 ? (uploadedRings - 1) * 6 * n : 0;
+
+    gl.bindVertexArray(tubeVAO);
+    const GLenum targets[4] = { GL_ARRAY_BUFFER, GL_ARRAY_BUFFER, GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER };
+    const void *data[4] = { tube.verts.data() + 3*first, tube.norms.data() + 3*first,
+            tube.colors.data() + 4*first, tube.indices.data() + firstIndex };
+    const size_t size[4] = { 3 * sizeof(float), 3 * sizeof(float), 4, 6 * sizeof(uint32_t) };
+    for (int b = 0; b < 4; b++) {
+        gl.bindBuffer(targets[b], tubeBuffers[b]);
+        if (0 == uploadedRings) {
+            //reallocate, the new storage is filled in below
+            gl.bufferData(targets[b], tubeCapacity * n * size[b], NULL, GL_DYNAMIC_DRAW);
+        }
+        if (3 == b) {
+            gl.bufferSubData(targets[b], firstIndex * sizeof(uint32_t),
+                    (tube.indices.size() - firstIndex) * sizeof(uint32_t), data[b]);
+        } else {
+            gl.bufferSubData(targets[b], first * size[b], count * size[b], data[b]);
+        }
+    }
+    uploadedRings = rings;
+}
+
+//adds count points of the curve to the tube
+void growTube(size_t count) {
+    size_t first = path.size() / 3;
+    path.resize(path.size() + 3 * count);
+    curve->generate(count, &path[3 * first]);
+    if (liftTube) {
+        for (size_t i = first; i < first + count; i++) {
+            path[3*i+2] = LIFT * i * CURVE_STEP;
+        }
+    }
+    tube.update(path);
+    uploadTube();
+}
+
+//drops the older half of the tube once it is MAX_TUBE_POINTS long, so the
+//tube is a ring like the 2D trail. The kept points are moved down so the
+//lift starts from 0 again and the tube stays in view.
+void trimTube() {
+    size_t points = path.size() / 3;
+    if (points + POINTS_PER_FRAME <= MAX_TUBE_POINTS) return;
+    size_t drop = points - MAX_TUBE_POINTS / 2;
+    path.erase(path.begin(), path.begin() + 3 * drop);
+    if (liftTube) {
+        float z0 = path[2];
+        for (size_t i = 2; i < path.size(); i += 3) path[i] -= z0;
+    }
+    tube.clear();
+    uploadedRings = 0;
+    tube.update(path);
+}
+
+//starts the tube over from t = 0
+void restartTube() {
+    path.clear();
+    tube.clear();
+    uploadedRings = 0;
+    delete curve;
+    curve = makeGenerator(chain, CURVE_STEP);
+}
+
 //updates values based on some change in time
 void update(float dt) {
     animTime += dt;
@@ -165,69 +159,61 @@ void reshape(int w, int h) {
     );
 }
 
-//display function for GLUT
-void display() {
-    glViewport(0,0,WIN_WIDTH,WIN_HEIGHT);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+static double seconds() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
 
-    //Setup the modelview matrix
-//    Mat4x4F modelCam = camera * modelView;
-    glm::mat4 modelCam = camera * modelView;
+//passes the matrices, light and animation time to the GPU in one upload and
+//selects the shader
+void loadTransforms() {
+    //the tube is scaled to about the size of the triangle
+    glm::mat4 model(1.0f);
+    if (tubeMode) {
+        model = glm::scale(model, glm::vec3(float(2 / chainExtent(chain))));
+    }
 
-    //grab the normal matrix from the modelview matrix (upper 3x3 entries of
-    //modelview).
-    glm::mat3 normalMatrix(modelCam);
-    normalMatrix = glm::inverse(normalMatrix);
-    normalMatrix = glm::transpose(normalMatrix);
+    transforms.setModelView(camera * modelView * model);
+    transforms.P = projection;
+    transforms.L_p = lightPos;
+    transforms.E = viewPos;
+    transforms.time = animTime;
+    gl.bindBuffer(GL_UNIFORM_BUFFER, transformBuffer);
+    gl.bufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(transforms), &transforms);
 
     //Tell OpenGL which shader program we want to use. In this case, we are only
     //using one, but in general we might have many shader programs.
-    glUseProgram(shader->program);
-
-    //Pass the matrices and animation time to GPU
-    glUniformMatrix4fv(
-            shader->modelViewLoc, //handle to variable in the shader program
-            1, //how many matrices we want to send
-            GL_FALSE, //transpose the matrix
-            glm::value_ptr(modelCam) //a pointer to an array containing the entries for
-              //the matrix
-            );
-    glUniformMatrix4fv(shader->projectionLoc, 1, GL_FALSE,
-            glm::value_ptr(projection));
-    glUniformMatrix3fv(shader->normalMatrixLoc, 1, GL_FALSE,
-            glm::value_ptr(normalMatrix));
-    glUniform3fv(shader->lightPosLoc, 1, glm::value_ptr(lightPos));
-    glUniform3fv(shader->viewPosLoc, 1, glm::value_ptr(viewPos));
-    glUniform1f(shader->timeLoc, animTime);
-
-
-    glBindBuffer(GL_ARRAY_BUFFER, shader->vertexBuffer); //which buffer we want
-      //to use
-    glEnableVertexAttribArray(shader->vertexLoc); //enable the attribute
-    glVertexAttribPointer(
-            shader->vertexLoc, //handle to variable in shader program
-            3, //vector size (e.g. for texture coordinates this could be 2).
-            GL_FLOAT, //what type of data is (e.g. GL_FLOAT, GL_INT, etc.)
-            GL_FALSE, //normalize the data?
-            0, //stride of data (e.g. offset in bytes). Most of the time leaving
-              //this at 0 (assumes data is in one, contiguous array) is fine
-              //unless we're doing something really complex.
-            NULL //since our stride will be 0 in general, leaving this NULL is
-              //also fine in general
-            );
-
-    //same procedure for the normal and color arrays
-    glBindBuffer(GL_ARRAY_BUFFER, shader->normalBuffer);
-    glEnableVertexAttribArray(shader->normalLoc);
-    glVertexAttribPointer(shader->normalLoc, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-
-    //same procedure for the normal and color arrays
-    glBindBuffer(GL_ARRAY_BUFFER, shader->colorBuffer);
-    glEnableVertexAttribArray(shader->colorLoc);
-    glVertexAttribPointer(shader->colorLoc, 4, GL_FLOAT, GL_FALSE, 0, NULL);
+    gl.useProgram(shader->program);
+}
 
-    //draw the vertices/normals we just specified.
-    glDrawArrays(GL_TRIANGLES, 0, numVerts);
+//display function for GLUT
+void display() {
+    double start = seconds();
+    gl.viewport(0,0,WIN_WIDTH,WIN_HEIGHT);
+    gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    loadTransforms();
+
+    if (tubeMode) {
+        trimTube();
+        growTube(POINTS_PER_FRAME);
+
+        //the vertex array object remembers which buffers feed which
+        //attributes, including the index buffer
+        gl.bindVertexArray(tubeVAO);
+        gpuTimer.begin();
+        gl.drawElements(GL_TRIANGLES, tube.indices.size(), GL_UNSIGNED_INT, NULL);
+        gpuTimer.end();
+    } else {
+        //the vertex array object remembers which buffers feed which attributes
+        gl.bindVertexArray(triangleVAO);
+
+        //draw the vertices/normals we just specified.
+        gpuTimer.begin();
+        gl.drawArrays(GL_TRIANGLES, 0, numVerts);
+        gpuTimer.end();
+    }
+    if (showHud) hud.draw(gl, WIN_HEIGHT);
 
     //update animation variables.
     //have time oscillate between 0.0 and 1.0.
@@ -236,8 +222,17 @@ void display() {
         deltaT = -deltaT;
     }
     update(deltaT);
+    double cpuMs = 1e3 * (seconds() - start); //not counting the wait for the swap
 
     glutSwapBuffers();
+
+    gl.endFrame();
+    gpuTimer.poll();
+    hud.frame(cpuMs, gpuTimer, gl.lastFrame);
+    if (showStats && 0 == ++frameCount % 60) {
+        cout << "GL calls per frame: " << gl.lastFrame.requested
+             << " requested, " << gl.lastFrame.issued << " issued" << endl;
+    }
 }
 
 //idle function for GLUT
@@ -251,6 +246,19 @@ void keyboard(unsigned char key, int x, int y) {
     case 27:
         exit(0);
         break;
+    case 'g':
+        showStats = !showStats;
+        break;
+    case 'h':
+        showHud = !showHud;
+        break;
+    case 't':
+        tubeMode = !tubeMode;
+        break;
+    case 'z':
+        liftTube = !liftTube;
+        restartTube();
+        break;
     }
 }
 
@@ -273,6 +281,8 @@ void setupGLUT() {
 //initialize OpenGL background color and vertex/normal arrays
 void setupGL() {
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    hud.color = glm::vec3(1, 1, 1); //on the black background
+    gl.setEnabled(GL_DEPTH_TEST, true); //the tube passes over itself
 
     //initiallize vertex and normal arrays
     //this is where you might want to read in your model
@@ -311,30 +321,15 @@ void setupShaders() {
     //create the shader program from a vertex and fragment shader
     shader = new Shader("shaders/light.vert", "shaders/light.frag");
 
-    //Here's where we setup handles to each variable that is used in the shader
-    //program. See the shader source code for more detail on what the difference
-    //is between uniform and vertex attribute variables.
-    shader->modelViewLoc = glGetUniformLocation(shader->program, "M");
-    shader->projectionLoc = glGetUniformLocation(shader->program, "P");
-    shader->normalMatrixLoc = glGetUniformLocation(shader->program, "M_n");
-    shader->timeLoc = glGetUniformLocation(shader->program, "time");
-    shader->lightPosLoc = glGetUniformLocation(shader->program, "L_p");
-    shader->viewPosLoc = glGetUniformLocation(shader->program, "E");
-
-    //notice that, since the vertex attribute norm is not used in the shader
-    //program, shader->normalLoc = -1. If we access norm in the shader program,
-    //then this value will be >= 0.
-    shader->vertexLoc = glGetAttribLocation(shader->program, "pos");
-    shader->normalLoc = glGetAttribLocation(shader->program, "norm");
-    shader->colorLoc = glGetAttribLocation(shader->program, "color");
-
-    //Create buffers for the vertex and normal attribute arrays
+    //Create buffers for the vertex, normal and color attribute arrays
     GLuint bufs[3];
     glGenBuffers(3, bufs);
 
-    shader->vertexBuffer = bufs[0];
-    shader->normalBuffer = bufs[1];
-    shader->colorBuffer = bufs[2];
+    //The vertex array object records which buffer feeds each attribute, so
+    //drawing only has to bind it again. The shader binds pos, norm and color
+    //to the fixed locations from Renderer.hpp.
+    glGenVertexArrays(1, &triangleVAO);
+    gl.bindVertexArray(triangleVAO);
 
     //This is where we pass the vertex/normal data to the GPU.
     //In genereal, the procedure for working with buffers is:
@@ -348,32 +343,113 @@ void setupShaders() {
     //at runtime, we might want to make this GL_DYNAMIC_DRAW instead. For right
     //now, it's not too important which you choose.
 
-    glBindBuffer(GL_ARRAY_BUFFER, shader->vertexBuffer);
-    glBufferData(
+    gl.bindBuffer(GL_ARRAY_BUFFER, bufs[0]);
+    gl.bufferData(
             GL_ARRAY_BUFFER, //what kind of buffer (an array)
             verts.size() * sizeof(float), //size of the buffer in bytes
             verts.data(), //pointer to data we want to fill the buffer with
             GL_STATIC_DRAW //how we intend to use the buffer
             );
+    glEnableVertexAttribArray(POS_ATTRIB); //enable the attribute
+    glVertexAttribPointer(
+            POS_ATTRIB, //attribute location the shaders bind pos to
+            3, //vector size (e.g. for texture coordinates this could be 2).
+            GL_FLOAT, //what type of data is (e.g. GL_FLOAT, GL_INT, etc.)
+            GL_FALSE, //normalize the data?
+            0, //stride of data (e.g. offset in bytes). Most of the time leaving
+              //this at 0 (assumes data is in one, contiguous array) is fine
+              //unless we're doing something really complex.
+            NULL //since our stride will be 0 in general, leaving this NULL is
+              //also fine in general
+            );
 
-    glBindBuffer(GL_ARRAY_BUFFER, shader->normalBuffer);
-    glBufferData(
+    //same procedure for the normal and color arrays
+    gl.bindBuffer(GL_ARRAY_BUFFER, bufs[1]);
+    gl.bufferData(
             GL_ARRAY_BUFFER,
             norms.size() * sizeof(float),
             norms.data(),
             GL_STATIC_DRAW
             );
+    glEnableVertexAttribArray(NORM_ATTRIB);
+    glVertexAttribPointer(NORM_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0, NULL);
 
-    glBindBuffer(GL_ARRAY_BUFFER, shader->colorBuffer);
-    glBufferData(
+    gl.bindBuffer(GL_ARRAY_BUFFER, bufs[2]);
+    gl.bufferData(
             GL_ARRAY_BUFFER, //what kind of buffer (an array)
             colors.size() * sizeof(float), //size of the buffer in bytes
             colors.data(), //pointer to data we want to fill the buffer with
             GL_STATIC_DRAW //how we intend to use the buffer
             );
+    glEnableVertexAttribArray(COLOR_ATTRIB);
+    glVertexAttribPointer(COLOR_ATTRIB, 4, GL_FLOAT, GL_FALSE, 0, NULL);
+
+    //uniform buffer for the Transform block
+    glGenBuffers(1, &transformBuffer);
+    gl.bindBuffer(GL_UNIFORM_BUFFER, transformBuffer);
+    gl.bufferData(GL_UNIFORM_BUFFER, sizeof(TransformBlock), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, TRANSFORM_BINDING, transformBuffer);
+
+    //The tube's buffers are allocated as it grows. Colors are stored as
+    //bytes and scaled to 0..1 when they are read.
+    glGenBuffers(4, tubeBuffers);
+    glGenVertexArrays(1, &tubeVAO);
+    gl.bindVertexArray(tubeVAO);
+    gl.bindBuffer(GL_ARRAY_BUFFER, tubeBuffers[0]);
+    glEnableVertexAttribArray(POS_ATTRIB);
+    glVertexAttribPointer(POS_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    gl.bindBuffer(GL_ARRAY_BUFFER, tubeBuffers[1]);
+    glEnableVertexAttribArray(NORM_ATTRIB);
+    glVertexAttribPointer(NORM_ATTRIB, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    gl.bindBuffer(GL_ARRAY_BUFFER, tubeBuffers[2]);
+    glEnableVertexAttribArray(COLOR_ATTRIB);
+    glVertexAttribPointer(COLOR_ATTRIB, 4, GL_UNSIGNED_BYTE, GL_TRUE, 0, NULL);
+    gl.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, tubeBuffers[3]);
+}
+
+//times drawing a tube over count points of the curve
+void benchmarkTubeDraw(size_t count) {
+    restartTube();
+    growTube(count);
+
+    const int frames = 20;
+    gl.viewport(0,0,WIN_WIDTH,WIN_HEIGHT);
+    loadTransforms();
+    gl.bindVertexArray(tubeVAO);
+    //first frame includes buffer setup in the driver. display() is not used
+    //since it would trim a tube longer than MAX_TUBE_POINTS
+    gl.drawElements(GL_TRIANGLES, tube.indices.size(), GL_UNSIGNED_INT, NULL);
+    glFinish();
+
+    GpuTimer timer;
+    int start = glutGet(GLUT_ELAPSED_TIME);
+    for (int i = 0; i < frames; i++) {
+        gl.clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        gl.useProgram(shader->program);
+        gl.bindVertexArray(tubeVAO);
+        timer.begin();
+        gl.drawElements(GL_TRIANGLES, tube.indices.size(), GL_UNSIGNED_INT, NULL);
+        timer.end();
+        glFinish();
+        timer.poll();
+    }
+    float ms = float(glutGet(GLUT_ELAPSED_TIME) - start) / frames;
+    cout << "drawing " << tube.triangles() << " triangles: " << ms << " ms/frame ("
+         << tube.triangles() / ms / 1000 << " M triangles/s)";
+    if (timer.results > 0) {
+        cout << ", " << timer.totalMs / timer.results << " ms/frame on the GPU";
+    }
+    cout << endl;
 }
 
 int main(int argc, char **argv) {
+    //--bench-tube [count] times building and drawing a tube over the curve
+    size_t benchTube = 0;
+    if (argc > 1 && string(argv[1]) == "--bench-tube") {
+        benchTube = argc > 2 ? strtoull(argv[2], NULL, 10) : 100000;
+        benchmarkTube(benchTube, cout);
+    }
+
     glutInit(&argc, argv);
     setupGLUT();
     setupGL();
@@ -381,10 +457,16 @@ int main(int argc, char **argv) {
     glewInit();
 
     setupShaders();
+    restartTube();
+    if (benchTube) {
+        benchmarkTubeDraw(benchTube);
+        return 0;
+    }
 
     glutMainLoop();
 
     if (shader) delete shader;
+    if (curve) delete curve;
 
     return 0;
 }
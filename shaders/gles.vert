@@ -1,10 +1,25 @@
 #version 150
 
-//These variables are constant for all vertices
-uniform mat4 M; //modelview matrix
-uniform mat4 P; //projection matrix
-uniform mat3 M_n; //normal matrix
-uniform float time; //time variable
+//These variables are constant for all vertices. The block is shared by all
+//programs and filled from TransformBlock in Renderer.hpp.
+layout(std140) uniform Transform {
+    mat4 M; //modelview matrix
+    mat4 P; //projection matrix
+    mat3 M_n; //normal matrix
+    vec3 L_p; //light position
+    float time; //time variable
+    vec3 E; //view position
+};
+
+//In trail mode the points are kept in a ring buffer (see drawCurve() in
+//main.cxx) and fade out with age, which follows from where in the ring a
+//vertex is.
+uniform int trailSize; //points in the ring, 0 if nothing fades
+uniform int trailNewest; //ring index of the newest point
+const int TRAIL_LEAD = 3; //slots before the ring repeating its last points
+
+//The preview of the whole curve is drawn under it in a lighter color.
+uniform int preview;
 
 //input variables from host
 in vec3 pos; //vertex position
@@ -18,5 +33,15 @@ void main() {
     
     //determine vertex color based on position and time
     vec4 color = vec4(0,8,8,0);
+    if (trailSize > 0) {
+        int i = gl_VertexID - TRAIL_LEAD;
+        if (i < 0) i += trailSize;
+        int age = trailNewest - i;
+        if (age < 0) age += trailSize;
+        color.a = 1.0 - float(age) / float(trailSize);
+    }
+    if (preview != 0) {
+        color = vec4(mix(vec3(0,1,1), vec3(1), 0.5), 1);
+    }
     frag_color = clamp(color, 0.0, 1.0);
 }
@@ -1,12 +1,15 @@
 #version 150
 
-//These variables are constant for all vertices
-uniform mat4 M; //modelview matrix
-uniform mat4 P; //projection matrix
-uniform mat3 M_n; //normal matrix
-uniform vec3 L_p; //light position
-uniform vec3 E; //view position
-uniform float time; //time variable
+//These variables are constant for all vertices. The block is shared by all
+//programs and filled from TransformBlock in Renderer.hpp.
+layout(std140) uniform Transform {
+    mat4 M; //modelview matrix
+    mat4 P; //projection matrix
+    mat3 M_n; //normal matrix
+    vec3 L_p; //light position
+    float time; //time variable
+    vec3 E; //view position
+};
 
 //input variables from host
 in vec3 pos; //vertex position
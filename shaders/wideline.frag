@@ -0,0 +1,9 @@
+#version 150
+
+in vec4 line_color;
+
+out vec4 end_color;
+
+void main() {
+    end_color = line_color;
+}